@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+
+// Heap accounting for instrumented builds. Compiling with -DALLOC_ACCOUNTING
+// replaces the global operator new, and every ALLOC_SCOPE("name") in the hot path
+// becomes a call site that counts its calls, the allocations made while it is
+// innermost (self) and everything allocated until it returns (total). Without the
+// define ALLOC_SCOPE expands to nothing and nothing is replaced.
+class AllocAccounting {
+public:
+    struct Counters {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct Site {
+        const char* name = nullptr;
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> selfAllocations{0};
+        std::atomic<uint64_t> selfBytes{0};
+        std::atomic<uint64_t> totalAllocations{0};
+        std::atomic<uint64_t> totalBytes{0};
+    };
+
+    static constexpr bool enabled =
+#ifdef ALLOC_ACCOUNTING
+        true;
+#else
+        false;
+#endif
+
+    static Site* site(const char* name) {
+        std::lock_guard<std::mutex> lock{registryMutex()};
+        auto& sites = registry();
+        auto& used = registered();
+        for (auto s = 0u; s < used; ++s)
+            if (std::strcmp(sites[s].name, name) == 0)
+                return &sites[s];
+        if (used == sites.size()) {
+            // Never fold a site into another one's counters; the report shows these apart.
+            overflowed() += 1;
+            return &overflow();
+        }
+        sites[used].name = name;
+        return &sites[used++];
+    }
+
+    static void record(size_t bytes) {
+        auto& counters = threadCounters();
+        counters.allocations += 1;
+        counters.bytes += bytes;
+        if (auto site = currentSite()) {
+            site->selfAllocations.fetch_add(1, std::memory_order_relaxed);
+            site->selfBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    // Allocations made by this thread so far.
+    static Counters thread() { return threadCounters(); }
+
+    // Allocations fn makes on this thread.
+    template<typename Fn>
+    static Counters measure(Fn&& fn) {
+        auto before = thread();
+        fn();
+        auto after = thread();
+        return {after.allocations - before.allocations, after.bytes - before.bytes};
+    }
+
+    // Runs a path declared allocation free; prints and returns false if it allocated.
+    template<typename Fn>
+    static bool expectNoAllocations(const std::string& name, Fn&& fn, std::ostream& out = std::cerr) {
+        auto counters = measure(fn);
+        if (counters.allocations == 0)
+            return true;
+        out << "zero allocation path " << name << " allocated " << counters.allocations
+            << " times, " << counters.bytes << " bytes" << std::endl;
+        return false;
+    }
+
+    static void report(std::ostream& out = std::cout) {
+        std::lock_guard<std::mutex> lock{registryMutex()};
+        out << std::left << std::setw(44) << "site" << std::right << std::setw(12) << "calls"
+            << std::setw(14) << "allocs/call" << std::setw(14) << "bytes/call" << std::setw(14) << "self allocs" << std::endl;
+        for (auto s = 0u; s < registered(); ++s) {
+            const auto& site = registry()[s];
+            auto calls = site.calls.load();
+            if (calls == 0)
+                continue;
+            out << std::left << std::setw(44) << site.name << std::right << std::setw(12) << calls
+                << std::setw(14) << site.totalAllocations.load() / calls
+                << std::setw(14) << site.totalBytes.load() / calls
+                << std::setw(14) << site.selfAllocations.load() << std::endl;
+        }
+        if (overflowed() > 0)
+            out << "<overflow> " << overflowed() << " sites past the first " << registry().size()
+                << " share " << overflow().calls.load() << " calls, " << overflow().totalAllocations.load()
+                << " allocations, " << overflow().selfAllocations.load() << " self allocations" << std::endl;
+    }
+
+private:
+    friend class AllocScope;
+
+    static std::array<Site, 64>& registry() {
+        static std::array<Site, 64> sites;
+        return sites;
+    }
+
+    // Shared by every site registered once the registry is full.
+    static Site& overflow() {
+        static Site site;
+        site.name = "<overflow>";
+        return site;
+    }
+
+    static unsigned& overflowed() {
+        static unsigned count = 0;
+        return count;
+    }
+
+    static unsigned& registered() {
+        static unsigned count = 0;
+        return count;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static Counters& threadCounters() {
+        static thread_local Counters counters;
+        return counters;
+    }
+
+    static Site*& currentSite() {
+        static thread_local Site* site = nullptr;
+        return site;
+    }
+};
+
+class AllocScope {
+public:
+    explicit AllocScope(AllocAccounting::Site* site)
+        : m_site{site}, m_previous{AllocAccounting::currentSite()}, m_before{AllocAccounting::thread()}
+    {
+        m_site->calls.fetch_add(1, std::memory_order_relaxed);
+        AllocAccounting::currentSite() = m_site;
+    }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+    ~AllocScope() {
+        auto after = AllocAccounting::thread();
+        m_site->totalAllocations.fetch_add(after.allocations - m_before.allocations, std::memory_order_relaxed);
+        m_site->totalBytes.fetch_add(after.bytes - m_before.bytes, std::memory_order_relaxed);
+        AllocAccounting::currentSite() = m_previous;
+    }
+
+private:
+    AllocAccounting::Site* m_site;
+    AllocAccounting::Site* m_previous;
+    AllocAccounting::Counters m_before;
+};
+
+#ifdef ALLOC_ACCOUNTING
+
+#define ALLOC_SCOPE_CONCAT_(a, b) a##b
+#define ALLOC_SCOPE_CONCAT(a, b) ALLOC_SCOPE_CONCAT_(a, b)
+#define ALLOC_SCOPE(name)                                                                   \
+    static AllocAccounting::Site* ALLOC_SCOPE_CONCAT(allocSite_, __LINE__) = AllocAccounting::site(name); \
+    AllocScope ALLOC_SCOPE_CONCAT(allocScope_, __LINE__){ALLOC_SCOPE_CONCAT(allocSite_, __LINE__)}
+
+// Replacements of the global allocation functions. Every program in this repository
+// is a single translation unit, which is where these definitions end up.
+void* operator new(std::size_t size) {
+    AllocAccounting::record(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    AllocAccounting::record(size);
+    auto align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#else
+
+#define ALLOC_SCOPE(name)
+
+#endif
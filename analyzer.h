@@ -1,5 +1,6 @@
 #pragma once
 
+#include "alloccount.h"
 #include "card.h"
 #include "hand.h"
 
@@ -15,9 +16,11 @@ public:
     virtual std::unique_ptr<Hand> analyze(const std::vector<CardValue_52_t>& cards) = 0;
 
     std::unique_ptr<Hand> analyzeChar(const std::vector<std::string>& cards) {
+        ALLOC_SCOPE("IAnalyzer::analyzeChar");
         std::vector<CardValue_52_t> v;
-        for (auto card : cards)
-            v.push_back(Card::fromString(card));
+        v.reserve(cards.size());
+        for (const auto& card : cards)
+            v.push_back(Card::parse(card));
         return analyze(v);
     }
 };
@@ -26,6 +29,7 @@ class Analyzer : public IAnalyzer {
 public:
 
     std::unique_ptr<Hand> analyze(const std::vector<CardValue_52_t>& cards) override {
+        ALLOC_SCOPE("Analyzer::analyze");
         const auto breakdown = Breakdown(cards);
         return checkHand(breakdown);
     }
@@ -88,6 +92,7 @@ private:
     }
     
     std::unique_ptr<Hand> checkStraightFlush(const Breakdown& breakdown) {
+        ALLOC_SCOPE("Analyzer::checkStraightFlush");
         if (breakdown.hasFlush && breakdown.hasStraight) {
 
             // std::unordered_set<CardValue_52_t> cardSet;
@@ -124,13 +129,13 @@ private:
     
     std::unique_ptr<Hand> checkQuads(const Breakdown& breakdown) {
         if (breakdown.hasQuads) {
-            CardValue_13_t quads = 0;
-            CardValue_13_t kicker = 0;
+            auto quads = -1;
+            auto kicker = -1;
 
-            for (int i = breakdown.valueCount.size(); i > 0; --i) {
+            for (int i = breakdown.valueCount.size() - 1; i >= 0; --i) {
                 if (breakdown.valueCount[i] == 4)
                     quads = i;
-                else if (breakdown.valueCount[i] > 0 && kicker == 0)
+                else if (breakdown.valueCount[i] > 0 && kicker < 0)
                     kicker = i;
             }
             return std::make_unique<Quads>(quads, kicker);
@@ -141,13 +146,13 @@ private:
     std::unique_ptr<Hand> checkFullHouse(const Breakdown& breakdown) {
         if (breakdown.sets > 0 && breakdown.sets + breakdown.pairs > 1) {
 
-            CardValue_13_t set = 0;
-            CardValue_13_t pair = 0;
-            for (int i = breakdown.valueCount.size(); i > 0; --i) {
+            auto set = -1;
+            auto pair = -1;
+            for (int i = breakdown.valueCount.size() - 1; i >= 0; --i) {
                 const auto count = breakdown.valueCount[i];
-                if (count == 3 && set == 0)
+                if (count == 3 && set < 0)
                     set = i;
-                else if (count > 1 && pair == 0)
+                else if (count > 1 && pair < 0)
                     pair = i;
             }
 
@@ -158,16 +163,17 @@ private:
     }
     
     std::unique_ptr<Hand> checkFlush(const Breakdown& breakdown) {
+        ALLOC_SCOPE("Analyzer::checkFlush");
         if (breakdown.hasFlush) {
             std::vector<CardValue_13_t> cards;
             for (auto card : breakdown.cards) {
-                if (Card::suit(card) == breakdown.flushSuit);
+                if (Card::suit(card) == breakdown.flushSuit)
                     cards.push_back(Card::value(card));
             }
 
             std::sort(cards.begin(), cards.end(), [](auto& a, auto& b){ return a > b; });
             if (cards.size() > 5)
-                cards.erase(cards.end() - 2, cards.end());
+                cards.resize(5);
 
             return std::make_unique<Flush>(cards, breakdown.flushSuit);
         }
@@ -186,19 +192,20 @@ private:
     std::unique_ptr<Hand> checkSet(const Breakdown& breakdown)
     {
         if (breakdown.sets > 0) {
-            CardValue_13_t set = 0;
-            CardValue_13_t kicker1 = 0;
-            CardValue_13_t kicker2 = 0;
+            auto set = -1;
+            auto kicker1 = -1;
+            auto kicker2 = -1;
 
-            for (int i = breakdown.valueCount.size(); i > 0; --i) {
+            for (int i = breakdown.valueCount.size() - 1; i >= 0; --i) {
                 const auto& count = breakdown.valueCount[i];
-                if (count == 3)
+                if (count == 3 && set < 0) {
                     set = i;
-                else if (count == 1)
-                    if (kicker1 == 0)
+                } else if (count > 0) {
+                    if (kicker1 < 0)
                         kicker1 = i;
-                    else if (kicker2 == 0)
+                    else if (kicker2 < 0)
                         kicker2 = i;
+                }
             }
 
             return std::make_unique<Set>(set, kicker1, kicker2);
@@ -208,15 +215,18 @@ private:
     }
     
     std::unique_ptr<Hand> checkPairs(const Breakdown& breakdown) {
+        ALLOC_SCOPE("Analyzer::checkPairs");
         if (breakdown.pairs > 0) {
+            // Only the two best of three pairs count, the third can still give the kicker.
+            const auto numPairs = std::min(breakdown.pairs, 2u);
             std::vector<CardValue_13_t> pairs;
             std::vector<CardValue_13_t> kickers;
 
-            for (int i = breakdown.valueCount.size(); i > 0; --i) {
+            for (int i = breakdown.valueCount.size() - 1; i >= 0; --i) {
                 const auto& count = breakdown.valueCount[i];
-                if (count > 1 && pairs.size() < breakdown.pairs)
+                if (count > 1 && pairs.size() < numPairs)
                     pairs.push_back(i);
-                else if (count >= 1 && kickers.size() < 5 - (2 * breakdown.pairs))
+                else if (count >= 1 && kickers.size() < 5 - 2 * numPairs)
                     kickers.push_back(i);
             }
 
@@ -224,7 +234,7 @@ private:
         }
 
         std::vector<CardValue_13_t> values;
-        for (auto i = breakdown.valueCount.size(); values.size() < 5; --i)
+        for (int i = breakdown.valueCount.size() - 1; values.size() < 5; --i)
             if (breakdown.valueCount[i] > 0)
                 values.push_back(i);
 
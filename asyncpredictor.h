@@ -0,0 +1,198 @@
+#pragma once
+
+#include "analyzer.h"
+#include "predictor.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+class JobCancelled : public std::runtime_error {
+public:
+    JobCancelled() : std::runtime_error{"equity job cancelled"} {}
+};
+
+// Handle of a running equity computation. The boards are split into chunks; a
+// chunk that finishes is merged into the partial result right away, and the job
+// only stops between chunks, so cancel() takes effect within one chunk's time.
+// A spot the preflop table answers has no chunks and completes in one step.
+class EquityJob {
+public:
+    // onDone runs once, on the worker that finishes the job, before the future is ready.
+    // onProgress runs after every chunk, concurrently from several workers, so it must be
+    // thread safe; a table answer reports once, at progress 1. An exception from either, or from the evaluation, stops the job and
+    // is rethrown by the future.
+    using DoneCallback = std::function<void(const Equity&)>;
+    using ProgressCallback = std::function<void(const EquityJob&)>;
+
+    // May be taken once per job.
+    std::future<Equity> future() { return m_promise.get_future(); }
+
+    void cancel() { m_cancelled = true; }
+    bool cancelled() const { return m_cancelled; }
+
+    // Fraction of the boards evaluated so far.
+    double progress() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_total ? double(m_partial.boards) / m_total : 1.;
+    }
+
+    // Counts over the boards evaluated so far.
+    Equity partial() const {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_partial;
+    }
+
+private:
+    friend class AsyncPredictor;
+
+    EquityJob(std::shared_ptr<Predictor> predictor, const std::vector<std::vector<CardValue_52_t>>& playerHands, uint64_t chunkSize)
+        : m_predictor{std::move(predictor)}, m_playerHands{playerHands}, m_chunkSize{chunkSize}
+    {
+        m_partial.wins.resize(playerHands.size(), 0);
+        m_partial.ties.resize(playerHands.size(), 0);
+        m_total = m_predictor->numberOfBoards(playerHands);
+        if (m_predictor->lookupPreflop(playerHands, m_partial))
+            m_answered = true;
+        else
+            m_chunks = (m_total + m_chunkSize - 1) / m_chunkSize;
+    }
+
+    // Completes a job the preflop table answered when it was created.
+    static void answer(const std::shared_ptr<EquityJob>& job) {
+        try {
+            if (job->m_onProgress)
+                job->m_onProgress(*job);
+        } catch (...) {
+            job->fail(std::current_exception());
+        }
+        job->leave();
+    }
+
+    // Evaluates one chunk and queues itself again at the back of the pool, so
+    // chunks of concurrent jobs interleave instead of running job after job.
+    static void step(const std::shared_ptr<EquityJob>& job, ThreadPool& pool) {
+        auto chunk = job->m_next++;
+        if (job->m_cancelled || chunk >= job->m_chunks) {
+            job->leave();
+            return;
+        }
+
+        try {
+            auto equity = job->m_predictor->predictRange(job->m_playerHands, chunk * job->m_chunkSize, job->m_chunkSize);
+            {
+                std::lock_guard<std::mutex> lock{job->m_mutex};
+                job->m_partial.merge(equity);
+            }
+            if (job->m_onProgress)
+                job->m_onProgress(*job);
+        } catch (...) {
+            job->fail(std::current_exception());
+            job->leave();
+            return;
+        }
+
+        pool.submit([job, &pool] { step(job, pool); });
+    }
+
+    // Keeps the first error and stops the other runners at their next chunk.
+    void fail(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_error)
+            m_error = error;
+        m_cancelled = true;
+    }
+
+    void leave() {
+        bool last = false;
+        Equity result;
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            last = --m_running == 0;
+            result = m_partial;
+            error = m_error;
+        }
+        if (!last)
+            return;
+
+        if (error) {
+            m_promise.set_exception(error);
+        } else if (result.boards == m_total) {
+            try {
+                if (m_onDone)
+                    m_onDone(result);
+            } catch (...) {
+                m_promise.set_exception(std::current_exception());
+                return;
+            }
+            m_promise.set_value(result);
+        } else {
+            m_promise.set_exception(std::make_exception_ptr(JobCancelled{}));
+        }
+    }
+
+    // Shared by every job of an AsyncPredictor; predictRange only reads its state.
+    std::shared_ptr<Predictor> m_predictor;
+    const std::vector<std::vector<CardValue_52_t>> m_playerHands;
+    const uint64_t m_chunkSize;
+    uint64_t m_total = 0;
+    uint64_t m_chunks = 0;
+    bool m_answered = false;
+
+    std::atomic<uint64_t> m_next{0};
+    std::atomic<bool> m_cancelled{false};
+    unsigned m_running = 0;
+
+    mutable std::mutex m_mutex;
+    Equity m_partial;
+    std::exception_ptr m_error;
+    std::promise<Equity> m_promise;
+    DoneCallback m_onDone;
+    ProgressCallback m_onProgress;
+};
+
+// Non blocking front of Predictor. Jobs run on a shared pool with at most one
+// chunk per worker in flight each, so many concurrent jobs never oversubscribe.
+// All jobs evaluate through one Predictor, so it is set up once, not per job.
+class AsyncPredictor {
+public:
+    AsyncPredictor(IAnalyzer& analyzer, ThreadPool& pool = ThreadPool::shared(), uint64_t chunkSize = 1 << 14)
+        : m_predictor{std::make_shared<Predictor>(analyzer)}, m_pool{pool}, m_chunkSize{std::max<uint64_t>(chunkSize, 1)}
+    {}
+
+    // Heads-up preflop jobs are then answered from the table; set before submitting jobs.
+    void usePreflopTable(const PreflopTable& table) { m_predictor->usePreflopTable(table); }
+
+    std::shared_ptr<EquityJob> submit(const std::vector<std::vector<CardValue_52_t>>& playerHands,
+                                      EquityJob::DoneCallback onDone = {},
+                                      EquityJob::ProgressCallback onProgress = {}) {
+        std::shared_ptr<EquityJob> job{new EquityJob{m_predictor, playerHands, m_chunkSize}};
+        job->m_onDone = std::move(onDone);
+        job->m_onProgress = std::move(onProgress);
+
+        if (job->m_answered) {
+            job->m_running = 1;
+            m_pool.submit([job] { EquityJob::answer(job); });
+            return job;
+        }
+
+        auto runners = std::max<uint64_t>(std::min<uint64_t>(m_pool.size(), job->m_chunks), 1);
+        job->m_running = runners;
+        auto& pool = m_pool;
+        for (auto r = 0u; r < runners; ++r)
+            m_pool.submit([job, &pool] { EquityJob::step(job, pool); });
+        return job;
+    }
+
+private:
+    std::shared_ptr<Predictor> m_predictor;
+    ThreadPool& m_pool;
+    uint64_t m_chunkSize;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 
 using CardValue_52_t = uint8_t;
 using CardValue_13_t = uint8_t;
@@ -10,13 +14,30 @@ using CardSuit_t = uint8_t;
 class Card
 {
 public:
-    static CardValue_52_t fromString(const std::string& str) {
-        CardValue_52_t value = 0;
-        value += std::find(values.begin(), values.end(), str[0]) - values.begin();
-        auto suitChecker = [&str](auto& suit) { return suit[0] == str[1]; };
-        value += (std::find_if(suits.begin(), suits.end(), suitChecker) - suits.begin()) * 13;
-        return value;
+    static constexpr CardValue_52_t invalid = 0xff;
+
+    static CardValue_52_t fromString(std::string_view str) {
+        return str.size() < 2 ? invalid : fromChars(str[0], str[1]);
+    }
+
+    // Same as fromString, throwing std::invalid_argument instead of returning invalid,
+    // for callers that would otherwise use the card as a bit or array index.
+    static CardValue_52_t parse(std::string_view str) {
+        auto card = fromString(str);
+        if (card == invalid)
+            throw std::invalid_argument("bad card " + std::string{str});
+        return card;
+    }
+
+    // Table driven parse of a value and suit character, invalid for anything else.
+    static CardValue_52_t fromChars(char value, char suit) {
+        auto v = valueIndex[static_cast<unsigned char>(value)];
+        auto s = suitIndex[static_cast<unsigned char>(suit)];
+        if (v == invalid || s == invalid)
+            return invalid;
+        return s * 13 + v;
     }
+
     static std::string toString(int c)
     {
         std::string code;
@@ -32,4 +53,29 @@ public:
 private:
     static constexpr std::array<const char*, 4> suits = {"diamonds", "hearts", "spades", "clubs"};
     static constexpr std::array<char, 13> values = {'2','3', '4','5','6','7','8','9','T','J','Q', 'K','A'};
-};
\ No newline at end of file
+
+    static constexpr std::array<CardValue_13_t, 256> valueIndex = [] {
+        std::array<CardValue_13_t, 256> index{};
+        for (auto& i : index)
+            i = invalid;
+        for (auto v = 0; v < 13; ++v)
+            index[static_cast<unsigned char>(values[v])] = v;
+        index['t'] = 8;
+        index['j'] = 9;
+        index['q'] = 10;
+        index['k'] = 11;
+        index['a'] = 12;
+        return index;
+    }();
+
+    static constexpr std::array<CardSuit_t, 256> suitIndex = [] {
+        std::array<CardSuit_t, 256> index{};
+        for (auto& i : index)
+            i = invalid;
+        for (auto s = 0; s < 4; ++s) {
+            index[static_cast<unsigned char>(suits[s][0])] = s;
+            index[static_cast<unsigned char>(suits[s][0] - 'a' + 'A')] = s;
+        }
+        return index;
+    }();
+};
@@ -1,28 +1,26 @@
+#pragma once
+
 #include <array>
+#include <cstdlib>
 
 #include "card.h"
+#include "deckvariant.h"
+#include "rng.h"
 
-class Deck {
+// The cards of a deck variant, numbered as in the 52 card deck.
+template<typename Variant>
+class BasicDeck {
 public:
-    Deck() { m_cards.fill(true); }
-    ~Deck() = default;
+    BasicDeck() { reset(); }
+    ~BasicDeck() = default;
 
     CardValue_52_t deal() {
-        CardValue_52_t rand = std::rand() % (52 - m_dealt);
-        CardValue_52_t index = 0;
-        
-        while (m_cards[index] == false)
-            index++;
-
-        while (rand) {
-            if (m_cards[index] == true)
-                rand--;
-            ++index;
-        }
+        return dealNth(std::rand() % (Variant::cards - m_dealt));
+    }
 
-        m_cards[index] = false;
-        m_dealt += 1;
-        return index;
+    // Reproducible deal driven by a counter based sample stream instead of rand()'s global state.
+    CardValue_52_t deal(SampleStream& stream) {
+        return dealNth(stream.below(Variant::cards - m_dealt));
     }
 
     void muck(CardValue_52_t card) {
@@ -31,12 +29,32 @@ public:
     }
 
     void reset() {
-        m_cards.fill(true);
+        for (auto c = 0; c < 52; ++c)
+            m_cards[c] = Variant::contains(c);
         m_dealt = 0;
     }
 
 private:
+    // Takes the n-th card, counting from zero, among those still in the deck.
+    CardValue_52_t dealNth(unsigned n) {
+        CardValue_52_t index = 0;
+        while (true) {
+            if (m_cards[index]) {
+                if (n == 0)
+                    break;
+                n--;
+            }
+            index++;
+        }
+
+        m_cards[index] = false;
+        m_dealt += 1;
+        return index;
+    }
+
     std::array<bool, 52> m_cards;
     unsigned m_dealt = 0;
 };
 
+using Deck = BasicDeck<StandardDeck>;
+using ShortDeckDeck = BasicDeck<ShortDeck>;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "card.h"
+#include "hand.h"
+
+#include <cstdint>
+
+// Compile time description of a deck. Cards keep their 52 card numbering in every
+// variant; a variant only says which of them are in play and how hands order.
+//   deckMask             the cards in play, as a 52 bit mask
+//   rankMask             the values in play, as a 13 bit mask
+//   wheel, wheelTop      rank mask of the lowest straight, the ace playing low, and its top value
+//   flushBeatsFullHouse  whether a flush outranks a full house
+// order() is the strength of a Hand::Rank under the variant, rankAt() its inverse, and
+// less() compares Hands by it; Hand itself orders by the standard ranks.
+struct StandardDeck {
+    static constexpr unsigned cards = 52;
+    static constexpr uint64_t deckMask = (uint64_t{1} << 52) - 1;
+    static constexpr uint16_t rankMask = 0x1fff;
+    static constexpr uint16_t wheel = 0x100f;
+    static constexpr int wheelTop = 3;
+    static constexpr bool flushBeatsFullHouse = false;
+
+    static constexpr bool contains(CardValue_52_t) { return true; }
+    static constexpr unsigned order(Hand::Rank rank) { return rank; }
+    static constexpr Hand::Rank rankAt(unsigned order) { return static_cast<Hand::Rank>(order); }
+    static bool less(Hand& a, Hand& b) { return a < b; }
+};
+
+// Six plus hold'em: deuces to fives removed, A-6-7-8-9 is the lowest straight and a
+// flush beats a full house.
+struct ShortDeck {
+    static constexpr unsigned cards = 36;
+    static constexpr uint16_t rankMask = 0x1ff0;
+    static constexpr uint64_t deckMask = uint64_t{rankMask} | uint64_t{rankMask} << 13
+                                       | uint64_t{rankMask} << 26 | uint64_t{rankMask} << 39;
+    static constexpr uint16_t wheel = 0x10f0;
+    static constexpr int wheelTop = 7;
+    static constexpr bool flushBeatsFullHouse = true;
+
+    static constexpr bool contains(CardValue_52_t card) { return deckMask >> card & 1; }
+
+    static constexpr unsigned order(Hand::Rank rank) {
+        return rank == Hand::Flush ? Hand::FullHouse : rank == Hand::FullHouse ? Hand::Flush : rank;
+    }
+
+    static constexpr Hand::Rank rankAt(unsigned order) { return static_cast<Hand::Rank>(ShortDeck::order(static_cast<Hand::Rank>(order))); }
+
+    static bool less(Hand& a, Hand& b) {
+        if (a.getRank() != b.getRank())
+            return order(a.getRank()) < order(b.getRank());
+        return a < b;
+    }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <chrono>
 #include <bitset>
@@ -6,16 +8,22 @@
 
 #include "analyzer.h"
 #include "card.h"
+#include "deckvariant.h"
 #include "hand.h"
 
-class FastAnalyzer : public IAnalyzer {
+// Bitmask evaluator of a deck variant (see deckvariant.h). Each variant gets its own
+// rank tables, and the variant's ordering is folded into the category bits of
+// evaluate(), so comparing values needs no knowledge of the variant.
+template<typename Variant>
+class BasicFastAnalyzer : public IAnalyzer {
 public:
     using Deck_t = uint64_t;
     using Suit_t = uint16_t;
 
-    FastAnalyzer() = default;
+    BasicFastAnalyzer() = default;
 
     std::unique_ptr<Hand> analyze(const std::vector<CardValue_52_t>& cards) override {
+        ALLOC_SCOPE("FastAnalyzer::analyze(vector)");
         Deck_t deck = 0;
         for (auto card : cards)
             deck |= (Deck_t{1} << card);
@@ -23,15 +31,100 @@ public:
     }
 
     std::unique_ptr<Hand> analyze(Deck_t deck) {
+        ALLOC_SCOPE("FastAnalyzer::analyze");
         auto suits = splitSuits(deck);
         auto merged = mergeSuits(suits);
         return checkAll(suits, merged);       
     }
 
+    // Allocation free alternative to analyze(): packs the hand into an integer that orders
+    // exactly like the Hand it describes. The category (Hand::Rank) sits in bits 20-23 and
+    // up to five deciding card values follow as nibbles, most significant first.
+    using Value_t = uint32_t;
+
+    static Value_t evaluate(Deck_t deck) {
+        const Suit_t s0 = deck & 0x1fff;
+        const Suit_t s1 = (deck >> 13) & 0x1fff;
+        const Suit_t s2 = (deck >> 26) & 0x1fff;
+        const Suit_t s3 = (deck >> 39) & 0x1fff;
+
+        Suit_t flush = 0;
+        for (auto suit : {s0, s1, s2, s3})
+            if (rankTables.count[suit] >= 5)
+                flush = suit;
+
+        if (flush) {
+            auto top = straightTop(flush);
+            if (top >= 0)
+                return category(Hand::StraightFlush) | top;
+        }
+
+        // Ranks held at least once, twice, three and four times.
+        const Suit_t c1 = s0 | s1 | s2 | s3;
+        const Suit_t c2 = (s0 & s1) | (s2 & s3) | ((s0 | s1) & (s2 | s3));
+        const Suit_t c4 = s0 & s1 & s2 & s3;
+        const Suit_t c3 = ((s0 & s1) & (s2 | s3)) | ((s2 & s3) & (s0 | s1));
+
+        if (c4) {
+            auto quads = highest(c4);
+            return category(Hand::Quads) | quads << 4 | highest(c1 & ~(Suit_t{1} << quads));
+        }
+
+        const Suit_t trips = c3 & ~c4;
+        if (Variant::flushBeatsFullHouse && flush)
+            return category(Hand::Flush) | topValues(flush, 5);
+
+        if (trips) {
+            auto set = highest(trips);
+            const Suit_t pairs = c2 & ~(Suit_t{1} << set);
+            if (pairs)
+                return category(Hand::FullHouse) | set << 4 | highest(pairs);
+        }
+
+        if (!Variant::flushBeatsFullHouse && flush)
+            return category(Hand::Flush) | topValues(flush, 5);
+
+        auto top = straightTop(c1);
+        if (top >= 0)
+            return category(Hand::Straight) | top;
+
+        if (trips) {
+            auto set = highest(trips);
+            return category(Hand::Set) | set << 8 | topValues(c1 & ~(Suit_t{1} << set), 2);
+        }
+
+        if (c2) {
+            if (rankTables.count[c2] >= 2) {
+                auto high = highest(c2);
+                auto low = highest(c2 & ~(Suit_t{1} << high));
+                const Suit_t used = (Suit_t{1} << high) | (Suit_t{1} << low);
+                return category(Hand::TwoPair) | high << 8 | low << 4 | highest(c1 & ~used);
+            }
+            auto pair = highest(c2);
+            return category(Hand::Pair) | pair << 12 | topValues(c1 & ~c2, 3);
+        }
+
+        return category(Hand::HighCard) | topValues(c1, 5);
+    }
+
+    static Hand::Rank rank(Value_t value) { return Variant::rankAt(value >> 20); }
+
+    // 8-or-better low: five distinct ranks of ace to eight, the ace playing low. Read off
+    // the merged rank mask, so suits and pairs never matter. Higher is better and 0 means
+    // the hand has no qualifying low.
+    using Low_t = uint8_t;
+
+    static Low_t evaluateLow(Deck_t deck) {
+        return rankTables.low[(deck | deck >> 13 | deck >> 26 | deck >> 39) & 0x1fff];
+    }
+
+    // The five low ranks of a qualifying low as a mask, bit 0 the ace up to bit 7 the eight.
+    static unsigned lowRanks(Low_t low) { return low ? 256 - low : 0; }
+
     uint64_t toDeck(const std::vector<std::string>& cards) {
         uint64_t d = 0;
-        for (auto card : cards)
-            d |= (uint64_t{1} << Card::fromString(card));
+        for (const auto& card : cards)
+            d |= (uint64_t{1} << Card::parse(card));
         return d;
     }
 
@@ -44,6 +137,62 @@ public:
     }
 
 private:
+    static Value_t category(Hand::Rank rank) { return Value_t(Variant::order(rank)) << 20; }
+
+    static Value_t highest(Suit_t mask) { return 31 - __builtin_clz(mask); }
+
+    // Top n values of a rank mask packed as nibbles, read from a table of the top five.
+    static Value_t topValues(Suit_t mask, unsigned n) {
+        unsigned held = std::min<unsigned>(rankTables.count[mask], 5);
+        return held > n ? rankTables.top[mask] >> 4 * (held - n) : rankTables.top[mask];
+    }
+
+    static int straightTop(Suit_t mask) { return rankTables.straight[mask]; }
+
+    // Per 13 bit rank mask: the number of ranks, the top five values, the top card
+    // of the best straight and the 8-or-better low. Counting by table also avoids a
+    // popcount library call on targets built without the instruction.
+    struct RankTables {
+        std::array<uint8_t, 0x2000> count;
+        std::array<Value_t, 0x2000> top;
+        std::array<int8_t, 0x2000> straight;
+        std::array<Low_t, 0x2000> low;
+    };
+
+    static inline const RankTables rankTables = [] {
+        RankTables tables{};
+        for (unsigned mask = 0; mask < 0x2000; ++mask) {
+            Value_t values = 0;
+            auto rest = mask;
+            for (auto i = 0; i < 5 && rest; ++i) {
+                auto value = highest(rest);
+                values = values << 4 | value;
+                rest &= ~(1u << value);
+            }
+            tables.top[mask] = values;
+            tables.count[mask] = __builtin_popcount(mask);
+
+            unsigned runs = mask & (mask << 1) & (mask << 2) & (mask << 3) & (mask << 4);
+            if (runs)
+                tables.straight[mask] = highest(runs);
+            else if ((mask & Variant::wheel) == Variant::wheel)
+                tables.straight[mask] = Variant::wheelTop;
+            else
+                tables.straight[mask] = -1;
+
+            // Ace to eight as bits 0 to 7. Of two lows the one whose five lowest ranks form
+            // the smaller mask is better, so the mask is stored inverted.
+            unsigned lows = (mask & 0x7f) << 1 | (mask >> 12 & 1);
+            unsigned five = 0;
+            for (auto i = 0; i < 5 && lows; ++i) {
+                five |= lows & -lows;
+                lows &= lows - 1;
+            }
+            tables.low[mask] = __builtin_popcount(five) == 5 ? Low_t(256 - five) : 0;
+        }
+        return tables;
+    }();
+
     std::array<Suit_t, 4> splitSuits(Deck_t deck) {
         std::array<Suit_t, 4> suits{};
         for (auto s = 0; s < 4; ++s) {
@@ -61,8 +210,6 @@ private:
     }
 
     std::unique_ptr<Hand> checkAll(const std::array<Suit_t, 4>& suits, Suit_t merged) {
-        auto b = std::chrono::high_resolution_clock().now();
-        
         std::array<unsigned, 13> values{};
         auto numquads = 0;
         auto numsets = 0;
@@ -105,9 +252,9 @@ private:
                 }
             }
             
-            auto mask = (Suit_t{0x100f} << (s*13));
+            auto mask = Suit_t{Variant::wheel};
             if ((mask & suit) == mask)
-                straightflush = std::max(straightflush, 3);
+                straightflush = std::max(straightflush, Variant::wheelTop);
         }
 
         if (straightflush >= 0) {
@@ -123,7 +270,7 @@ private:
                     kicker = i;
             }
             return std::make_unique<Quads>(value, kicker);
-        } else if (numsets > 0 && numsets + numpairs > 1) {
+        } else if (numsets > 0 && numsets + numpairs > 1 && !(Variant::flushBeatsFullHouse && flushsuit >= 0)) {
             auto set = -1;
             auto pair = -1;
             for (int i = values.size() - 1; i >= 0; --i) {
@@ -138,7 +285,7 @@ private:
             auto suit = suits[flushsuit];
             for (int i = 12; i >= 0; --i) {
                 auto mask = (Suit_t{1} << i);
-                if (suit & mask) {
+                if ((suit & mask) && cards.size() < 5) {
                     cards.push_back(i);
                 }
             }
@@ -153,38 +300,41 @@ private:
             }
         }
 
-        auto mask = Suit_t{0x100f};
+        auto mask = Suit_t{Variant::wheel};
         if ((mask & merged) == mask)
-            straight = std::max(straight, 3);
+            straight = std::max(straight, Variant::wheelTop);
 
         if (straight >= 0) {
             return std::make_unique<Straight>(straight);
         } else if (numsets > 0) {
-            CardValue_13_t set = 0;
-            CardValue_13_t kicker1 = 0;
-            CardValue_13_t kicker2 = 0;
+            auto set = -1;
+            auto kicker1 = -1;
+            auto kicker2 = -1;
 
             for (int i = values.size() - 1; i >= 0; --i) {
-                if (values[i] == 3)
+                if (values[i] == 3 && set < 0) {
                     set = i;
-                else if (values[i] == 1)
-                    if (kicker1 == 0)
+                } else if (values[i] > 0) {
+                    if (kicker1 < 0)
                         kicker1 = i;
-                    else if (kicker2 == 0)
+                    else if (kicker2 < 0)
                         kicker2 = i;
+                }
             }
 
             return std::make_unique<Set>(set, kicker1, kicker2);
         } else if (numpairs > 0) {
 
+            // Only the two best of three pairs count, the third can still give the kicker.
+            const auto usedpairs = std::min(numpairs, 2);
             std::vector<CardValue_13_t> pairs;
             std::vector<CardValue_13_t> kickers;
 
             for (int i = values.size() - 1; i >= 0; --i) {
                 const auto& count = values[i];
-                if (count > 1 && pairs.size() < numpairs)
+                if (count > 1 && pairs.size() < usedpairs)
                     pairs.push_back(i);
-                else if (count >= 1 && kickers.size() < 5 - (2 * numpairs))
+                else if (count >= 1 && kickers.size() < 5 - 2 * usedpairs)
                     kickers.push_back(i);
             }
 
@@ -198,63 +348,12 @@ private:
 
             return std::make_unique<HighCard>(cards);
         }
-        
-        auto e = std::chrono::high_resolution_clock().now();
-        std::cout << std::dec << std::chrono::duration_cast<std::chrono::nanoseconds>(e-b).count() << std::endl;
-    }
-
-    void checkFlush(Deck_t deck) {
-        auto b = std::chrono::high_resolution_clock().now();
-
-        for (auto s = 0; s < 4; ++s) {
-            auto count = 0u;
-            for (auto c = s*13; c < s*13+13; ++c) {
-                if ((uint64_t{1} << c) & deck)
-                    count += 1;
-            }
-            std::cout << "count " << count << std::endl;
-        }
-
-        auto e = std::chrono::high_resolution_clock().now();
-        std::cout << std::dec << std::chrono::duration_cast<std::chrono::nanoseconds>(e-b).count() << std::endl;
-    }
-
-    int checkStraight(Suit_t suit) {
-        auto b = std::chrono::high_resolution_clock().now();
-
-        int straight = -1;
-        
-        for (auto c = 0; c < 9; ++c) {
-            auto mask = (Suit_t{0x1f} << c);
-            if ((mask & suit) == mask)
-                straight = std::max(straight, c + 4);
-                // std::cout << "straight " << c+4 << std::endl;
-        }
-        
-        Suit_t mask = 0x100f;
-        if ((mask & suit) == mask)
-            straight = std::max(straight, 5);
-            // std::cout << "straight " << 5 << '\n';
-        
-        auto e = std::chrono::high_resolution_clock().now();
-        // std::cout << std::dec << std::chrono::duration_cast<std::chrono::nanoseconds>(e-b).count() << std::endl;
-
-        return straight;
-    }
-
-    int checkCount(const std::array<Suit_t, 4>& suits) {
-        std::array<unsigned, 13> count{};
-        unsigned maxIndex = 0;
-        for (auto c = 0; c < 13; ++c) {
-            auto mask = Suit_t{1} << c;
-            for (auto suit : suits)
-                count[c] += (mask & suit);
-            if (count[maxIndex] < count[c])
-                maxIndex = c;
-        }
     }
 };
 
+using FastAnalyzer = BasicFastAnalyzer<StandardDeck>;
+using ShortDeckAnalyzer = BasicFastAnalyzer<ShortDeck>;
+
 // void test() {
     // Deck_t d  = 0b0000000000001111111001111000000000000000000000000000000000000000;
     // Deck_t d2 = 0b0000000000000000000011000000000000010000000000000100000000000001;
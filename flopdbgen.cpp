@@ -0,0 +1,30 @@
+#include "flopdb.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// flopdbgen <path> [threads]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: flopdbgen <path> [threads]\n";
+        return 1;
+    }
+
+    unsigned threads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+    auto tstart = std::chrono::high_resolution_clock::now();
+
+    try {
+        FlopDatabaseGenerator::generate(argv[1], threads);
+        FlopDatabase database{argv[1]};
+        auto tend = std::chrono::high_resolution_clock::now();
+        std::cout << FlopDatabase::flopCount << " flops written to " << argv[1] << " in "
+                  << std::chrono::duration_cast<std::chrono::seconds>(tend - tstart).count() << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
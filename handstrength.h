@@ -0,0 +1,110 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "ladder.h"
+
+#include <array>
+#include <vector>
+
+// Effective hand strength features of a hand on a flop, turn or river board, all
+// against a uniform opponent holding:
+//   hs    share of holdings the hand is ahead of now, ties counting half
+//   hs2   mean of the squared hand strength after the next card
+//   ppot  chance of getting ahead with the next card when behind now
+//   npot  chance of falling behind with the next card when ahead now
+//   ehs   hs * (1 - npot) + (1 - hs) * ppot
+// One pass evaluates every opponent holding once on the current board and once
+// per next card, with the hand's own value computed once per board.
+class HandStrength {
+public:
+    struct Metrics {
+        double hs = 0.;
+        double hs2 = 0.;
+        double ppot = 0.;
+        double npot = 0.;
+        double ehs = 0.;
+    };
+
+    static Metrics compute(const std::vector<CardValue_52_t>& hero, const std::vector<CardValue_52_t>& board) {
+        FastAnalyzer::Deck_t heroMask = 0;
+        FastAnalyzer::Deck_t boardMask = 0;
+        for (auto card : hero)
+            heroMask |= FastAnalyzer::Deck_t{1} << card;
+        for (auto card : board)
+            boardMask |= FastAnalyzer::Deck_t{1} << card;
+        return compute(heroMask, boardMask);
+    }
+
+    static Metrics compute(FastAnalyzer::Deck_t hero, FastAnalyzer::Deck_t board) {
+        enum { Ahead = 0, Tied, Behind };
+        const auto dead = hero | board;
+
+        std::array<FastAnalyzer::Deck_t, Holdings::count> opponents;
+        std::array<uint8_t, Holdings::count> now;
+        std::array<unsigned, 3> nowCount{};
+        unsigned n = 0;
+
+        const auto heroValue = FastAnalyzer::evaluate(hero | board);
+        for (auto h = 0u; h < Holdings::count; ++h) {
+            auto mask = Holdings::mask(h);
+            if (mask & dead)
+                continue;
+            opponents[n] = mask;
+            now[n] = relation(heroValue, FastAnalyzer::evaluate(board | mask));
+            nowCount[now[n]] += 1;
+            ++n;
+        }
+
+        Metrics metrics;
+        metrics.hs = (nowCount[Ahead] + nowCount[Tied] / 2.) / n;
+        metrics.hs2 = metrics.hs * metrics.hs;
+        metrics.ehs = metrics.hs;
+        if (__builtin_popcountll(board) >= 5)
+            return metrics;
+
+        // potential[now][next] counts opponent holdings per relation now and after the next card.
+        std::array<std::array<double, 3>, 3> potential{};
+        double hs2 = 0.;
+        unsigned cards = 0;
+
+        for (auto c = 0; c < 52; ++c) {
+            const auto card = FastAnalyzer::Deck_t{1} << c;
+            if (card & dead)
+                continue;
+
+            const auto next = board | card;
+            const auto heroNext = FastAnalyzer::evaluate(hero | next);
+            std::array<unsigned, 3> nextCount{};
+            for (auto o = 0u; o < n; ++o) {
+                if (opponents[o] & card)
+                    continue;
+                auto r = relation(heroNext, FastAnalyzer::evaluate(next | opponents[o]));
+                potential[now[o]][r] += 1;
+                nextCount[r] += 1;
+            }
+
+            auto seen = nextCount[Ahead] + nextCount[Tied] + nextCount[Behind];
+            auto hsNext = (nextCount[Ahead] + nextCount[Tied] / 2.) / seen;
+            hs2 += hsNext * hsNext;
+            ++cards;
+        }
+
+        auto total = [&](unsigned r) { return potential[r][Ahead] + potential[r][Tied] + potential[r][Behind]; };
+        auto behind = total(Behind) + total(Tied) / 2;
+        auto ahead = total(Ahead) + total(Tied) / 2;
+
+        metrics.hs2 = hs2 / cards;
+        if (behind > 0.)
+            metrics.ppot = (potential[Behind][Ahead] + potential[Behind][Tied] / 2 + potential[Tied][Ahead] / 2) / behind;
+        if (ahead > 0.)
+            metrics.npot = (potential[Ahead][Behind] + potential[Tied][Behind] / 2 + potential[Ahead][Tied] / 2) / ahead;
+        metrics.ehs = metrics.hs * (1 - metrics.npot) + (1 - metrics.hs) * metrics.ppot;
+        return metrics;
+    }
+
+private:
+    static uint8_t relation(FastAnalyzer::Value_t hero, FastAnalyzer::Value_t opponent) {
+        return hero > opponent ? 0 : hero == opponent ? 1 : 2;
+    }
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One archived hand per line: an id, the five board cards, then each player's
+// hole cards after a '|'. Whitespace between cards is optional.
+//   1043 Ah Kd 5c 7s 2h | As Ks | Qh Jh
+struct ParsedHand {
+    static constexpr unsigned maxPlayers = 10;
+
+    uint64_t id = 0;
+    FastAnalyzer::Deck_t board = 0;
+    unsigned players = 0;
+    std::array<FastAnalyzer::Deck_t, maxPlayers> holes{};
+};
+
+// Showdown value of every player in a hand, in FastAnalyzer::evaluate terms.
+struct Showdown {
+    std::array<FastAnalyzer::Value_t, ParsedHand::maxPlayers> values{};
+};
+
+// Parses hands straight out of a character buffer. Cards become bits in the hand's
+// masks through Card::fromChars, so nothing is copied or allocated per card.
+class HandHistoryParser {
+public:
+    explicit HandHistoryParser(std::string_view text) : m_text{text} {}
+
+    // Next well formed hand, false once the buffer is exhausted. Malformed lines are skipped.
+    bool next(ParsedHand& hand) {
+        while (m_pos < m_text.size()) {
+            auto end = m_text.find('\n', m_pos);
+            if (end == std::string_view::npos)
+                end = m_text.size();
+            auto line = m_text.substr(m_pos, end - m_pos);
+            m_pos = end + 1;
+
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (parseLine(line, hand))
+                return true;
+            ++m_malformed;
+        }
+        return false;
+    }
+
+    uint64_t malformed() const { return m_malformed; }
+
+    static bool parseLine(std::string_view line, ParsedHand& hand) {
+        size_t i = 0;
+        auto skipSpaces = [&]() {
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r'))
+                ++i;
+        };
+
+        skipSpaces();
+        if (i == line.size() || line[i] < '0' || line[i] > '9')
+            return false;
+        hand.id = 0;
+        while (i < line.size() && line[i] >= '0' && line[i] <= '9')
+            hand.id = hand.id * 10 + (line[i++] - '0');
+
+        hand.board = 0;
+        hand.players = 0;
+        FastAnalyzer::Deck_t* target = &hand.board;
+        FastAnalyzer::Deck_t seen = 0;
+
+        while (true) {
+            skipSpaces();
+            if (i == line.size())
+                break;
+            if (line[i] == '|') {
+                if (hand.players == ParsedHand::maxPlayers)
+                    return false;
+                target = &hand.holes[hand.players++];
+                *target = 0;
+                ++i;
+                continue;
+            }
+            if (i + 1 >= line.size())
+                return false;
+            auto card = Card::fromChars(line[i], line[i + 1]);
+            if (card == Card::invalid)
+                return false;
+            auto bit = FastAnalyzer::Deck_t{1} << card;
+            if (seen & bit)
+                return false;
+            seen |= bit;
+            *target |= bit;
+            i += 2;
+        }
+
+        if (__builtin_popcountll(hand.board) != 5 || hand.players == 0)
+            return false;
+        for (auto p = 0u; p < hand.players; ++p)
+            if (__builtin_popcountll(hand.holes[p]) != 2)
+                return false;
+        return true;
+    }
+
+private:
+    std::string_view m_text;
+    size_t m_pos = 0;
+    uint64_t m_malformed = 0;
+};
+
+// Streams a memory mapped hand history through the parser and hands fixed size
+// batches of parsed hands and their showdown values to a sink. The batch buffers
+// are allocated once, up front.
+class HandHistoryIngester {
+public:
+    struct Stats {
+        uint64_t hands = 0;
+        uint64_t malformed = 0;
+        double seconds = 0;
+
+        double handsPerSecond() const { return seconds > 0 ? hands / seconds : 0; }
+    };
+
+    explicit HandHistoryIngester(size_t batchSize = 4096)
+        : m_hands(std::max<size_t>(batchSize, 1)), m_showdowns(m_hands.size())
+    {}
+
+    // sink(const ParsedHand* hands, const Showdown* showdowns, size_t count)
+    template<typename Sink>
+    Stats ingest(const std::string& path, Sink&& sink) {
+        MappedFile file{path};
+        file.sequential();
+        return ingest(std::string_view{file.data(), file.size()}, sink);
+    }
+
+    template<typename Sink>
+    Stats ingest(std::string_view text, Sink&& sink) {
+        auto tstart = std::chrono::high_resolution_clock::now();
+
+        Stats stats;
+        HandHistoryParser parser{text};
+        size_t count = 0;
+
+        while (parser.next(m_hands[count])) {
+            if (++count == m_hands.size()) {
+                flush(count, sink);
+                stats.hands += count;
+                count = 0;
+            }
+        }
+        flush(count, sink);
+        stats.hands += count;
+        stats.malformed = parser.malformed();
+
+        auto tend = std::chrono::high_resolution_clock::now();
+        stats.seconds = std::chrono::duration<double>(tend - tstart).count();
+        return stats;
+    }
+
+private:
+    template<typename Sink>
+    void flush(size_t count, Sink& sink) {
+        if (count == 0)
+            return;
+        for (size_t h = 0; h < count; ++h) {
+            const auto& hand = m_hands[h];
+            for (auto p = 0u; p < hand.players; ++p)
+                m_showdowns[h].values[p] = FastAnalyzer::evaluate(hand.board | hand.holes[p]);
+        }
+        sink(m_hands.data(), m_showdowns.data(), count);
+    }
+
+    std::vector<ParsedHand> m_hands;
+    std::vector<Showdown> m_showdowns;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "predictor.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// The 1326 two card holdings, numbered in CombinationCalculator order of their cards.
+class Holdings {
+public:
+    static constexpr unsigned count = 1326;
+
+    static unsigned index(CardValue_52_t a, CardValue_52_t b) {
+        return table().index[a][b];
+    }
+
+    static const std::array<CardValue_52_t, 2>& cards(unsigned holding) {
+        return table().cards[holding];
+    }
+
+    static FastAnalyzer::Deck_t mask(unsigned holding) {
+        const auto& c = cards(holding);
+        return (FastAnalyzer::Deck_t{1} << c[0]) | (FastAnalyzer::Deck_t{1} << c[1]);
+    }
+
+private:
+    struct Table {
+        std::array<std::array<uint16_t, 52>, 52> index{};
+        std::array<std::array<CardValue_52_t, 2>, count> cards{};
+    };
+
+    static const Table& table() {
+        static const Table t = [] {
+            Table t;
+            unsigned h = 0;
+            for (auto a = 0; a < 52; ++a)
+                for (auto b = a + 1; b < 52; ++b) {
+                    t.index[a][b] = t.index[b][a] = h;
+                    t.cards[h++] = {CardValue_52_t(a), CardValue_52_t(b)};
+                }
+            return t;
+        }();
+        return t;
+    }
+};
+
+// Weight of every holding in a range, zero for holdings outside it.
+using HoldingRange = std::array<double, Holdings::count>;
+
+// All holdings that fit a five card board, evaluated once and sorted by strength.
+// Range against range results then come from one ascending sweep that keeps the
+// villain weight seen so far, in total and per card: the weight a hero holding
+// beats is the total minus what shares one of its two cards. That is O(n log n)
+// per board instead of comparing every pair of holdings.
+class HandLadder {
+public:
+    struct Rung {
+        FastAnalyzer::Value_t value;
+        uint16_t holding;
+    };
+
+    // Weighted villain holdings a hero holding beats, ties and meets at all.
+    struct Outcome {
+        double wins = 0.;
+        double ties = 0.;
+        double total = 0.;
+
+        double equity() const { return total > 0. ? (wins + ties / 2) / total : 0.; }
+    };
+
+    explicit HandLadder(FastAnalyzer::Deck_t board) : m_board{board} {
+        // Sorted as packed value and holding keys, which is much cheaper than sorting the structs.
+        std::array<uint64_t, Holdings::count> keys;
+        size_t n = 0;
+        for (auto h = 0u; h < Holdings::count; ++h) {
+            auto mask = Holdings::mask(h);
+            if (!(mask & board))
+                keys[n++] = uint64_t{FastAnalyzer::evaluate(board | mask)} << 16 | h;
+        }
+        std::sort(keys.begin(), keys.begin() + n);
+
+        m_rungs.resize(n);
+        for (size_t r = 0; r < n; ++r)
+            m_rungs[r] = {FastAnalyzer::Value_t(keys[r] >> 16), uint16_t(keys[r] & 0xffff)};
+    }
+
+    FastAnalyzer::Deck_t board() const { return m_board; }
+    const std::vector<Rung>& rungs() const { return m_rungs; }
+
+    // Outcome of every holding on the board against the villain range, by holding index.
+    void sweep(const HoldingRange& villain, std::array<Outcome, Holdings::count>& outcomes) const {
+        std::array<double, 52> cardTotal{};
+        double total = 0.;
+        for (const auto& rung : m_rungs) {
+            auto w = villain[rung.holding];
+            const auto& c = Holdings::cards(rung.holding);
+            cardTotal[c[0]] += w;
+            cardTotal[c[1]] += w;
+            total += w;
+        }
+
+        std::array<double, 52> cardBelow{};
+        std::array<double, 52> cardGroup{};
+        double below = 0.;
+        for (size_t begin = 0; begin < m_rungs.size();) {
+            auto end = begin;
+            double group = 0.;
+            for (; end < m_rungs.size() && m_rungs[end].value == m_rungs[begin].value; ++end) {
+                auto w = villain[m_rungs[end].holding];
+                const auto& c = Holdings::cards(m_rungs[end].holding);
+                cardGroup[c[0]] += w;
+                cardGroup[c[1]] += w;
+                group += w;
+            }
+
+            for (auto r = begin; r < end; ++r) {
+                auto h = m_rungs[r].holding;
+                const auto& c = Holdings::cards(h);
+                auto& outcome = outcomes[h];
+                // The villain holding equal to h shares both cards and sits in this group.
+                outcome.wins = below - cardBelow[c[0]] - cardBelow[c[1]];
+                outcome.ties = group - cardGroup[c[0]] - cardGroup[c[1]] + villain[h];
+                outcome.total = total - cardTotal[c[0]] - cardTotal[c[1]] + villain[h];
+            }
+
+            // Move the group into the running sums, touching only the cards it uses.
+            for (auto r = begin; r < end; ++r) {
+                for (auto c : Holdings::cards(m_rungs[r].holding)) {
+                    cardBelow[c] += cardGroup[c];
+                    cardGroup[c] = 0.;
+                }
+            }
+            below += group;
+            begin = end;
+        }
+    }
+
+    // Hero range against villain range, weighted by both ranges.
+    Outcome versus(const HoldingRange& hero, const HoldingRange& villain) const {
+        std::array<Outcome, Holdings::count> outcomes;
+        sweep(villain, outcomes);
+
+        Outcome result;
+        for (const auto& rung : m_rungs) {
+            auto w = hero[rung.holding];
+            if (w == 0.)
+                continue;
+            const auto& outcome = outcomes[rung.holding];
+            result.wins += w * outcome.wins;
+            result.ties += w * outcome.ties;
+            result.total += w * outcome.total;
+        }
+        return result;
+    }
+
+    // Range against range on an unfinished board, summing one ladder per runout.
+    static Outcome versus(const HoldingRange& hero, const HoldingRange& villain, const std::vector<CardValue_52_t>& board) {
+        FastAnalyzer::Deck_t boardMask = 0;
+        for (auto card : board)
+            boardMask |= FastAnalyzer::Deck_t{1} << card;
+
+        std::vector<CardValue_52_t> cards;
+        for (auto c = 0; c < 52; ++c)
+            if (!(boardMask & (FastAnalyzer::Deck_t{1} << c)))
+                cards.push_back(c);
+
+        Outcome result;
+        const unsigned k = 5 - board.size();
+        auto indices = CombinationCalculator::unrank(0, cards.size(), k);
+        do {
+            auto runout = boardMask;
+            for (auto i : indices)
+                runout |= FastAnalyzer::Deck_t{1} << cards[i];
+            auto outcome = HandLadder{runout}.versus(hero, villain);
+            result.wins += outcome.wins;
+            result.ties += outcome.ties;
+            result.total += outcome.total;
+        } while (CombinationCalculator::next(indices, cards.size()));
+        return result;
+    }
+
+private:
+    FastAnalyzer::Deck_t m_board;
+    std::vector<Rung> m_rungs;
+};
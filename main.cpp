@@ -1,13 +1,30 @@
 
+#include "alloccount.h"
 #include "analyzer.h"
+#include "asyncpredictor.h"
 #include "card.h"
+#include "deck.h"
+#include "deckvariant.h"
 #include "fastanalyzer.h"
+#include "flopdb.h"
+#include "handstrength.h"
+#include "ingest.h"
+#include "ladder.h"
+#include "matchups.h"
+#include "opponents.h"
 #include "predictor.h"
-// #include "deck.h"
+#include "replay.h"
+#include "rng.h"
+#include "sweep.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <assert.h>
+#include <unistd.h>
 
 void testHandComparison() {
     assert(StraightFlush(11, 0) < StraightFlush(12, 0));
@@ -54,6 +71,11 @@ void testAnalzerWithExampleCombinations(IAnalyzer& analyzer) {
     assert(Pair({7, 5}, {12}) == *analyzer.analyzeChar({"Ad", "2d", "3d", "7c", "7h", "9h", "9c"}));
     assert(Pair({5}, {12, 8, 7}) == *analyzer.analyzeChar({"Ad", "2d", "3d", "7c", "7h", "9h", "Tc"}));
     assert(HighCard({12, 11, 8, 7, 5}) == *analyzer.analyzeChar({"Ad", "2d", "3d", "7c", "Kh", "9h", "Tc"}));
+    assert(StraightFlush(3, 1) == *analyzer.analyzeChar({"Ah", "2h", "3h", "4h", "5h", "9c", "Kd"}));
+    assert(Flush({12, 11, 7, 5, 2}, 3) == *analyzer.analyzeChar({"Ac", "Kc", "9c", "7c", "4c", "Qd", "Jh"}));
+    assert(Set(0, 9, 7) == *analyzer.analyzeChar({"2d", "2h", "2s", "9c", "Jd", "4c", "6h"}));
+    assert(Pair({7, 5}, {1}) == *analyzer.analyzeChar({"2d", "3d", "3c", "7c", "7h", "9h", "9c"}));
+    assert(HighCard({10, 8, 6, 4, 2}) == *analyzer.analyzeChar({"2d", "4h", "6c", "8s", "Td", "Qh", "3c"}));
 }
 
 void testAnalyzers() {
@@ -63,9 +85,799 @@ void testAnalyzers() {
     testAnalzerWithExampleCombinations(fast);
 }
 
+void testExhaustiveSweep() {
+    ExhaustiveSweep sweep{2, 1 << 12};
+    auto report = sweep.run(100000);
+    assert(report.hands == 100000 && report.mismatches == 0 && !report.complete());
+    for (const auto& counts : report.counts) {
+        uint64_t hands = 0;
+        for (auto count : counts)
+            hands += count;
+        assert(hands == report.hands);
+    }
+    assert(report.counts[ExhaustiveSweep::AnalyzerImpl][Hand::StraightFlush] > 0);
+}
+
+void testCardParsing() {
+    for (auto c = 0; c < 52; ++c)
+        assert(Card::fromString(Card::toString(c)) == c);
+    assert(Card::fromString("as") == Card::fromString("Ad") + 26);
+    assert(Card::fromString("Xd") == Card::invalid);
+    assert(Card::fromString("Ax") == Card::invalid);
+    assert(Card::fromString("A") == Card::invalid);
+    for (auto bad : {"Xd", "A"}) {
+        bool rejected = false;
+        try {
+            FastAnalyzer{}.toDeck({"Ad", bad});
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+
+    HandHistoryParser parser{"1 Ah Kd 5c 7s 2h | As Ks | QhJh\n2 Ah Kd 5c 7s | As Ks\n3 AhKd5c7s2h|AsAh\n\n4 Ah Kd 5c 7s 2h|Ts 9s\n"};
+    ParsedHand hand;
+    assert(parser.next(hand) && hand.id == 1 && hand.players == 2);
+    assert(hand.holes[1] == ((uint64_t{1} << Card::fromString("Qh")) | (uint64_t{1} << Card::fromString("Jh"))));
+    assert(parser.next(hand) && hand.id == 4);
+    assert(!parser.next(hand) && parser.malformed() == 2);
+}
+
+void testCombinationRanking() {
+    std::vector<CardValue_52_t> cards{0, 1, 2, 3, 4, 5, 6};
+    auto combinations = CombinationCalculator::calculate(cards, 3);
+    assert(combinations.size() == CombinationCalculator::numberOfCombinations(7, 3));
+    assert(CombinationCalculator::numberOfCombinations(48, 5) == 1712304);
+
+    auto indices = CombinationCalculator::unrank(0, 7, 3);
+    for (uint64_t r = 0; r < combinations.size(); ++r) {
+        assert(CombinationCalculator::unrank(r, 7, 3) == indices);
+        assert(CombinationCalculator::rank(indices, 7) == r);
+        for (auto i = 0; i < 3; ++i)
+            assert(combinations[r][i] == cards[indices[i]]);
+        assert(CombinationCalculator::next(indices, 7) == (r + 1 < combinations.size()));
+    }
+}
+
+void testPredictRangeMerges(IAnalyzer& analyzer) {
+    Predictor predictor{analyzer};
+    std::vector<std::vector<CardValue_52_t>> players{{12, 12+13, 0, 14, 30, 45}, {11, 10, 0, 14, 30, 45}};
+    auto whole = predictor.predictRange(players, 0, predictor.numberOfBoards(players));
+    assert(whole.boards == 44);
+
+    Equity merged;
+    merged.merge(predictor.predictRange(players, 30, 100));
+    merged.merge(predictor.predictRange(players, 0, 13));
+    merged.merge(predictor.predictRange(players, 13, 17));
+    assert(merged.begin == 0 && merged.boards == whole.boards);
+    assert(merged.wins == whole.wins && merged.ties == whole.ties);
+    assert(merged.spans().size() == 1 && merged.spans()[0].second == 44);
+
+    bool overlapping = false;
+    try {
+        merged.merge(predictor.predictRange(players, 10, 5));
+    } catch (const std::invalid_argument&) {
+        overlapping = true;
+    }
+    assert(overlapping && merged.boards == whole.boards);
+}
+
+void testPreflopTable() {
+    bool swapped = false;
+    auto key = PreflopTable::canonicalKey({12, 11}, {0, 13}, swapped);
+    bool swappedRelabeled = false;
+    assert(PreflopTable::canonicalKey({12 + 26, 11 + 26}, {13 + 26, 0 + 26}, swappedRelabeled) == key);
+    assert(swappedRelabeled == swapped);
+    bool swappedSeats = false;
+    assert(PreflopTable::canonicalKey({0, 13}, {12, 11}, swappedSeats) == key);
+    assert(swappedSeats != swapped);
+
+    auto hero = (uint64_t{1} << 12) | (uint64_t{1} << 11);
+    auto villain = (uint64_t{1} << 0) | (uint64_t{1} << 13);
+    auto entry = PreflopTableGenerator::headsUp(hero, villain);
+    auto reversed = PreflopTableGenerator::headsUp(villain, hero);
+    auto relabeled = PreflopTableGenerator::headsUp(hero << 26, (uint64_t{1} << 26) | (uint64_t{1} << 39));
+    assert(entry.ties == reversed.ties);
+    assert(entry.wins == PreflopTable::boardsPerMatchup - reversed.wins - reversed.ties);
+    assert(entry.wins == relabeled.wins && entry.ties == relabeled.ties);
+
+    char path[] = "/tmp/preflopXXXXXX";
+    auto fd = ::mkstemp(path);
+    assert(fd >= 0);
+    ::close(fd);
+    bool ignored = false;
+    std::vector<uint32_t> keys{key, PreflopTable::canonicalKey({25, 37}, {5, 18}, ignored)};
+    std::sort(keys.begin(), keys.end());
+    PreflopTableGenerator::generate(path, 2, keys);
+    PreflopTable table{path};
+    std::remove(path);
+    assert(table.loaded() && table.size() == 2);
+
+    // Each matchup as generated, with suits relabeled and with seats swapped.
+    std::vector<std::pair<std::array<CardValue_52_t, 2>, std::array<CardValue_52_t, 2>>> matchups{
+        {{12, 11}, {0, 13}}, {{12 + 26, 11 + 26}, {26, 39}}, {{0, 13}, {12, 11}},
+        {{25, 37}, {5, 18}}, {{12, 50}, {31, 5}}, {{5, 18}, {25, 37}},
+    };
+    for (const auto& [h, v] : matchups) {
+        PreflopTable::Matchup matchup;
+        assert(table.lookup(h, v, matchup));
+        auto expected = PreflopTableGenerator::headsUp((uint64_t{1} << h[0]) | (uint64_t{1} << h[1]),
+                                                       (uint64_t{1} << v[0]) | (uint64_t{1} << v[1]));
+        assert(matchup.wins == expected.wins && matchup.ties == expected.ties);
+    }
+    PreflopTable::Matchup missing;
+    assert(!table.lookup({12, 11}, {10, 9}, missing));
+
+    FastAnalyzer analyzer{};
+    Predictor predictor{analyzer};
+    predictor.usePreflopTable(table);
+    std::vector<std::vector<CardValue_52_t>> players{{0, 13}, {12, 11}};
+    auto equity = predictor.predictRange(players, 0, predictor.numberOfBoards(players));
+    assert(equity.boards == PreflopTable::boardsPerMatchup);
+    assert(equity.wins[1] == entry.wins && equity.ties[1] == entry.ties && equity.wins[0] == reversed.wins);
+
+    // A budget far too small to enumerate still gets the exact table counts.
+    auto estimate = predictor.predictWithin(players, std::chrono::microseconds{1});
+    assert(estimate.exact && estimate.equity.boards == PreflopTable::boardsPerMatchup);
+    assert(estimate.equity.wins == equity.wins && estimate.equity.ties == equity.ties && estimate.winError(1) == 0.);
+
+    // An async job on a table spot completes with one progress report instead of chunking.
+    AsyncPredictor async{analyzer};
+    async.usePreflopTable(table);
+    std::atomic<unsigned> updates{0};
+    auto job = async.submit(players, {}, [&](const EquityJob& j) {
+        assert(j.progress() == 1.);
+        ++updates;
+    });
+    auto result = job->future().get();
+    assert(updates == 1 && job->progress() == 1.);
+    assert(result.boards == equity.boards && result.wins == equity.wins && result.ties == equity.ties);
+}
+
+void testPredictWithin(IAnalyzer& analyzer) {
+    Predictor predictor{analyzer};
+    predictor.seed(7);
+
+    std::vector<std::vector<CardValue_52_t>> river{{12, 12+13, 0, 14, 30, 45}, {11, 10, 0, 14, 30, 45}};
+    auto exact = predictor.predictWithin(river, std::chrono::milliseconds{50});
+    auto expected = predictor.predictRange(river, 0, predictor.numberOfBoards(river));
+    assert(exact.exact && exact.equity.wins == expected.wins && exact.winError(0) == 0.);
+
+    auto sampled = predictor.predictWithin({{4, 12}, {2, 3}}, std::chrono::milliseconds{5});
+    assert(!sampled.exact && sampled.equity.boards > 0 && sampled.winError(0) > 0.);
+    assert(std::abs(sampled.winRate(0) - 0.6277) < 5 * sampled.winError(0) + 0.01);
+}
+
+void testRandomOpponents() {
+    // A rainbow turn and a three-heart turn, where a heart river puts four on board.
+    std::vector<std::pair<std::vector<CardValue_52_t>, std::vector<CardValue_52_t>>> spots{
+        {{12, 12 + 13}, {0, 14, 30, 45}},
+        {{13 + 12, 11}, {13, 18, 20, 48}},
+    };
+    RandomOpponents opponents{};
+    for (const auto& [hero, board] : spots) {
+        auto result = opponents.predict(hero, board);
+        assert(result.exact && result.boards == 46);
+
+        uint64_t heroMask = 0;
+        uint64_t boardMask = 0;
+        for (auto card : hero)
+            heroMask |= uint64_t{1} << card;
+        for (auto card : board)
+            boardMask |= uint64_t{1} << card;
+        auto dead = heroMask | boardMask;
+        double wins = 0.;
+        double shares = 0.;
+        uint64_t deals = 0;
+        for (auto a = 0; a < 52; ++a)
+            for (auto b = a + 1; b < 52; ++b)
+                for (auto river = 0; river < 52; ++river) {
+                    auto villain = (uint64_t{1} << a) | (uint64_t{1} << b);
+                    auto last = uint64_t{1} << river;
+                    if ((villain & dead) || (last & (dead | villain)))
+                        continue;
+                    auto h = FastAnalyzer::evaluate(dead | last);
+                    auto v = FastAnalyzer::evaluate(boardMask | villain | last);
+                    wins += h > v;
+                    shares += h > v ? 1. : h == v ? .5 : 0.;
+                    ++deals;
+                }
+        assert(std::abs(result.win[1] - wins / deals) < 1e-9);
+        assert(std::abs(result.share[1] - shares / deals) < 1e-9);
+        assert(result.share[2] < result.share[1] && result.win[9] < result.win[8]);
+    }
+
+    auto rejects = [&](std::vector<CardValue_52_t> hero, std::vector<CardValue_52_t> board) {
+        try {
+            opponents.predict(hero, board);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects({12}, {0, 14, 30}));
+    assert(rejects({12, 25}, {0, 14, 30, 45, 9, 10}));
+    assert(rejects({12, 25}, {0, 14, 12}));
+    assert(rejects({12, 52}, {0, 14, 30}));
+}
+
+void testHandLadder() {
+    HoldingRange hero{};
+    HoldingRange villain{};
+    for (auto h = 0u; h < Holdings::count; ++h) {
+        hero[h] = (h * 7919) % 5 == 0 ? 1. + h % 3 : 0.;
+        villain[h] = (h * 104729) % 3 == 0 ? 0.5 + h % 2 : 0.;
+    }
+
+    uint64_t board = (uint64_t{1} << 0) | (uint64_t{1} << 14) | (uint64_t{1} << 30) | (uint64_t{1} << 45) | (uint64_t{1} << 9);
+    HandLadder ladder{board};
+    assert(ladder.rungs().size() == 1081);
+    auto fast = ladder.versus(hero, villain);
+
+    HandLadder::Outcome slow;
+    for (auto a = 0u; a < Holdings::count; ++a)
+        for (auto b = 0u; b < Holdings::count; ++b) {
+            auto ma = Holdings::mask(a);
+            auto mb = Holdings::mask(b);
+            if ((ma & mb) || ((ma | mb) & board))
+                continue;
+            auto w = hero[a] * villain[b];
+            auto va = FastAnalyzer::evaluate(board | ma);
+            auto vb = FastAnalyzer::evaluate(board | mb);
+            slow.wins += va > vb ? w : 0.;
+            slow.ties += va == vb ? w : 0.;
+            slow.total += w;
+        }
+    assert(std::abs(fast.wins - slow.wins) < 1e-6);
+    assert(std::abs(fast.ties - slow.ties) < 1e-6);
+    assert(std::abs(fast.total - slow.total) < 1e-6);
+}
+
+void testHandStrength() {
+    std::vector<CardValue_52_t> hero{Card::fromString("Ad"), Card::fromString("Qd")};
+    std::vector<CardValue_52_t> board{Card::fromString("3d"), Card::fromString("4c"), Card::fromString("Jd")};
+
+    HoldingRange uniform;
+    uniform.fill(1.);
+    uint64_t boardMask = 0;
+    for (auto card : board)
+        boardMask |= uint64_t{1} << card;
+    std::array<HandLadder::Outcome, Holdings::count> outcomes;
+    HandLadder{boardMask}.sweep(uniform, outcomes);
+
+    auto flop = HandStrength::compute(hero, board);
+    assert(std::abs(flop.hs - outcomes[Holdings::index(hero[0], hero[1])].equity()) < 1e-9);
+    assert(flop.ppot > 0.2 && flop.npot < flop.ppot);
+    assert(std::abs(flop.ehs - (flop.hs * (1 - flop.npot) + (1 - flop.hs) * flop.ppot)) < 1e-12);
+
+    board.push_back(Card::fromString("Ks"));
+    board.push_back(Card::fromString("2h"));
+    auto river = HandStrength::compute(hero, board);
+    assert(river.ppot == 0. && river.npot == 0. && river.ehs == river.hs);
+}
+
+void testFlopDatabase() {
+    assert(FlopDatabase::canonicalFlops().size() == FlopDatabase::flopCount);
+
+    std::vector<CardValue_52_t> board{Card::fromString("Kc"), Card::fromString("7s"), Card::fromString("2c")};
+    FastAnalyzer::Deck_t boardMask = 0;
+    for (auto card : board)
+        boardMask |= FastAnalyzer::Deck_t{1} << card;
+    FlopDatabase::Permutation permutation;
+    auto canonical = FlopDatabase::canonicalFlop(boardMask, permutation);
+    FlopDatabase::Permutation other;
+    assert(FlopDatabase::canonicalFlop(FlopDatabase::relabel(boardMask, {3, 2, 1, 0}), other) == canonical);
+
+    auto entries = FlopDatabaseGenerator::flop(canonical);
+    std::array<CardValue_52_t, 2> hero{Card::fromString("Ac"), Card::fromString("Qc")};
+    auto a = FlopDatabase::relabel(hero[0], permutation);
+    auto b = FlopDatabase::relabel(hero[1], permutation);
+    const auto& entry = entries[FlopDatabase::slot(canonical, a, b)];
+
+    HoldingRange uniform;
+    uniform.fill(1.);
+    HoldingRange single{};
+    single[Holdings::index(hero[0], hero[1])] = 1.;
+    auto exact = HandLadder::versus(single, uniform, board).equity();
+    assert(std::abs(entry.equity / 65535. - exact) < 1e-4);
+
+    unsigned made = 0;
+    unsigned strength = 0;
+    for (auto count : entry.made)
+        made += count;
+    for (auto count : entry.strength)
+        strength += count;
+    assert(made == FlopDatabase::runoutsPerHolding && strength == FlopDatabase::runoutsPerHolding);
+    assert(entry.made[Hand::Flush] > 0);
+    assert(std::abs(FlopDatabase::approximateVersus(entries.data(), canonical, a, b, uniform) - exact) < 0.02);
+
+    // Against a narrow range the independence assumption shows: aces against the three
+    // sets win about 8.7%, the approximation says about 11.4%.
+    std::array<CardValue_52_t, 2> aces{Card::fromString("As"), Card::fromString("Ad")};
+    HoldingRange sets{};
+    for (auto h = 0u; h < Holdings::count; ++h) {
+        const auto& c = Holdings::cards(h);
+        if (Holdings::mask(h) & boardMask)
+            continue;
+        for (auto card : board)
+            if (Card::value(c[0]) == Card::value(card) && Card::value(c[1]) == Card::value(card))
+                sets[h] = 1.;
+    }
+    HoldingRange overpair{};
+    overpair[Holdings::index(aces[0], aces[1])] = 1.;
+    auto setEquity = HandLadder::versus(overpair, sets, board).equity();
+    auto estimate = FlopDatabase::approximateVersus(entries.data(), canonical, FlopDatabase::relabel(aces[0], permutation),
+                                                    FlopDatabase::relabel(aces[1], permutation), sets);
+    assert(setEquity > 0.08 && setEquity < 0.095);
+    assert(estimate > setEquity && estimate < setEquity + 0.05);
+}
+
+void testHiLo(IAnalyzer& analyzer) {
+    auto low = [](const std::vector<std::string>& cards) {
+        return FastAnalyzer::evaluateLow(FastAnalyzer{}.toDeck(cards));
+    };
+    assert(low({"Ad", "2h", "3s", "4c", "5d", "Kd", "Kh"}) > low({"Ad", "2h", "3s", "4c", "6d", "7d", "8h"}));
+    assert(FastAnalyzer::lowRanks(low({"Ad", "2h", "4s", "6c", "8d", "8h", "Kd"})) == 0xab);
+    assert(low({"Ad", "2h", "3s", "4c", "9d", "Td", "Ah"}) == 0);
+    assert(low({"2d", "3h", "4s", "6c", "7d", "8d", "Kh"}) == low({"2c", "3d", "4h", "6s", "7c", "9d", "Ks"}));
+
+    Predictor predictor{analyzer};
+    // Kings full against the nut low on the river split the pot.
+    std::vector<std::vector<CardValue_52_t>> river{
+        {Card::fromString("Kc"), Card::fromString("Kh"), Card::fromString("3d"), Card::fromString("4d"),
+         Card::fromString("8s"), Card::fromString("Kd"), Card::fromString("8c")},
+        {Card::fromString("Ac"), Card::fromString("2h"), Card::fromString("3d"), Card::fromString("4d"),
+         Card::fromString("8s"), Card::fromString("Kd"), Card::fromString("8c")}};
+    auto split = predictor.predictHiLoRange(river, 0, 1);
+    assert(split.boards == 1 && split.lowBoards == 1);
+    assert(split.share(0) == 0.5 && split.share(1) == 0.5 && split.scoops[0] == 0 && split.scoops[1] == 0);
+
+    std::vector<std::vector<CardValue_52_t>> flop{{12, 0, 14, 28, 45}, {11, 24, 14, 28, 45}, {3, 17, 14, 28, 45}};
+    auto total = predictor.numberOfBoards(flop);
+    auto whole = predictor.predictHiLoRange(flop, 0, total);
+    auto merged = predictor.predictHiLoRange(flop, 0, 300);
+    merged.merge(predictor.predictHiLoRange(flop, 300, total));
+    assert(merged.boards == whole.boards && merged.shares == whole.shares && merged.scoops == whole.scoops);
+
+    uint64_t pot = 0;
+    for (auto p = 0u; p < flop.size(); ++p) {
+        pot += whole.shares[p];
+        assert(whole.scoops[p] <= whole.highWins[p] && whole.lowWins[p] <= whole.lowBoards);
+    }
+    assert(pot == HiLoEquity::potUnits * whole.boards);
+
+    // Without low cards on the board or in hand nobody qualifies and high takes it all.
+    std::vector<std::vector<CardValue_52_t>> high{{12, 12+13, 11, 10, 9}, {7+26, 7+39, 11, 10, 9}};
+    auto equity = predictor.predictRange(high, 0, predictor.numberOfBoards(high));
+    auto hilo = predictor.predictHiLoRange(high, 0, predictor.numberOfBoards(high));
+    assert(hilo.lowBoards == 0 && hilo.scoops[0] == equity.wins[0] && hilo.scoops[1] == equity.wins[1]);
+
+    // Eleven players would split pots into shares potUnits does not divide.
+    std::vector<std::vector<CardValue_52_t>> crowded;
+    for (auto p = 0; p < 11; ++p)
+        crowded.push_back({CardValue_52_t(2 * p), CardValue_52_t(2 * p + 1), 50, 51, 49});
+    auto rejected = false;
+    try {
+        predictor.predictHiLoRange(crowded, 0, 1);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected);
+}
+
+void testShortDeck() {
+    ShortDeckAnalyzer shortDeck{};
+    auto value = [](const std::vector<std::string>& cards) {
+        return ShortDeckAnalyzer::evaluate(ShortDeckAnalyzer{}.toDeck(cards));
+    };
+    // A-6-7-8-9 is the lowest straight, and a flush beats a full house.
+    auto wheel = value({"Ad", "6h", "7s", "8c", "9d", "Kd", "Kh"});
+    assert(ShortDeckAnalyzer::rank(wheel) == Hand::Straight && wheel < value({"6d", "7h", "8s", "9c", "Td", "Kd", "Kh"}));
+    assert(ShortDeckAnalyzer::rank(value({"Ad", "6d", "7d", "8d", "9d", "Kc", "Kh"})) == Hand::StraightFlush);
+    auto flush = value({"Ad", "6d", "8d", "9d", "Jd", "Kc", "Kh"});
+    auto full = value({"Ad", "Ah", "As", "Kc", "Kh", "6c", "7h"});
+    assert(ShortDeckAnalyzer::rank(flush) == Hand::Flush && ShortDeckAnalyzer::rank(full) == Hand::FullHouse && full < flush);
+    assert(FastAnalyzer::rank(FastAnalyzer::evaluate(FastAnalyzer{}.toDeck({"Ad", "6d", "8d", "9d", "Jd", "Kc", "Kd"}))) == Hand::Flush);
+
+    auto flushHand = shortDeck.analyze(shortDeck.toDeck({"Ad", "6d", "8d", "9d", "Jd", "Kc", "Kh"}));
+    auto fullHand = shortDeck.analyze(shortDeck.toDeck({"Ad", "Ah", "As", "Kc", "Kh", "6c", "7h"}));
+    assert(ShortDeck::less(*fullHand, *flushHand) && !ShortDeck::less(*flushHand, *fullHand));
+
+    ShortDeckDeck deck;
+    SampleStream stream{5, 0};
+    uint64_t dealt = 0;
+    for (auto c = 0u; c < ShortDeck::cards; ++c)
+        dealt |= uint64_t{1} << deck.deal(stream);
+    assert(dealt == ShortDeck::deckMask);
+
+    // 32 cards left for the flop, turn and river.
+    ShortDeckPredictor predictor{shortDeck};
+    std::vector<std::vector<CardValue_52_t>> players{{12, 12+13}, {11, 10+13}};
+    assert(predictor.numberOfBoards(players) == 201376);
+    auto equity = predictor.predictRange(players, 0, 2000);
+    assert(equity.boards == 2000 && equity.wins[0] + equity.wins[1] <= 2000 && equity.wins[0] > equity.wins[1]);
+}
+
+void testRunItTwice(IAnalyzer& analyzer) {
+    Predictor predictor{analyzer};
+    // Aces against a flush draw on the turn, run twice: 44 * 43 ordered river pairs.
+    std::vector<std::vector<CardValue_52_t>> turn{{12, 12+13, 3, 7, 8+26, 0+39}, {9, 10, 3, 7, 8+26, 0+39}};
+    const auto deals = predictor.numberOfDeals(turn, 2);
+    assert(deals == 44 * 43);
+    auto twice = predictor.predictRunsRange(turn, 2, 0, deals);
+    auto once = predictor.predictRange(turn, 0, predictor.numberOfBoards(turn));
+
+    // Every run on its own is worth the single run equity, and so is the whole pot.
+    for (auto p = 0; p < 2; ++p) {
+        const auto single = MultiBoardEquity::potUnits * (2 * once.wins[p] + once.ties[p]) / 2;
+        assert(twice.boardShares[0][p] == single * 43 && twice.boardShares[1][p] == single * 43);
+        assert(twice.shares[p] == 2 * single * 43);
+    }
+    assert(twice.scoops[0] + twice.scoops[1] < deals && twice.scoops[1] == (once.wins[1] * (once.wins[1] - 1)));
+
+    // Ranges across a change of the first run merge exactly, sampled or enumerated.
+    std::vector<std::vector<CardValue_52_t>> flop{{12, 11, 3, 7, 8+26}, {9, 9+13, 3, 7, 8+26}};
+    auto whole = predictor.predictRunsRange(flop, 2, 890, 30);
+    auto merged = predictor.predictRunsRange(flop, 2, 890, 13);
+    merged.merge(predictor.predictRunsRange(flop, 2, 903, 17));
+    assert(merged.deals == 30 && merged.shares == whole.shares && merged.boardShares == whole.boardShares && merged.scoops == whole.scoops);
+
+    predictor.seed(5);
+    auto sampled = predictor.sampleRuns(flop, 3, 0, 200);
+    auto sharded = predictor.sampleRuns(flop, 3, 120, 80);
+    sharded.merge(predictor.sampleRuns(flop, 3, 0, 120));
+    assert(sharded.deals == 200 && sharded.shares == sampled.shares && sharded.boardShares == sampled.boardShares);
+    assert(sampled.shares[0] + sampled.shares[1] == MultiBoardEquity::potUnits * 3 * 200);
+
+    // Eleven players would split run pots into shares potUnits does not divide.
+    std::vector<std::vector<CardValue_52_t>> crowded;
+    for (auto p = 0; p < 11; ++p)
+        crowded.push_back({CardValue_52_t(2 * p), CardValue_52_t(2 * p + 1), 50, 51, 49});
+    auto rejections = 0;
+    for (auto call : {0, 1, 2}) {
+        try {
+            if (call == 0)
+                predictor.numberOfDeals(crowded, 2);
+            else if (call == 1)
+                predictor.predictRunsRange(crowded, 2, 0, 1);
+            else
+                predictor.sampleRuns(crowded, 2, 0, 1);
+        } catch (const std::invalid_argument&) {
+            ++rejections;
+        }
+    }
+    assert(rejections == 3);
+}
+
+void testPackedSpot(IAnalyzer& analyzer) {
+    Predictor predictor{analyzer};
+    std::vector<std::vector<CardValue_52_t>> turn{{12, 12+13, 3, 7, 8+26, 0+39}, {9, 10, 3, 7, 8+26, 0+39}, {5, 5+13, 3, 7, 8+26, 0+39}};
+    std::vector<std::vector<CardValue_52_t>> flop{{12, 11, 3, 7, 8+26}, {9, 9+13, 3, 7, 8+26}};
+    for (const auto& players : {turn, flop}) {
+        auto spot = PackedSpot::fromPlayers(players);
+        assert(spot.valid() && Predictor::numberOfBoards(spot) == predictor.numberOfBoards(players));
+        auto packed = Predictor::predictPacked(spot);
+        auto equity = predictor.predictRange(players, 0, predictor.numberOfBoards(players));
+        assert(packed.boards == equity.boards);
+        for (auto p = 0u; p < players.size(); ++p)
+            assert(packed.wins[p] == equity.wins[p] && packed.ties[p] == equity.ties[p]);
+    }
+
+    // Dead cards leave the stub, here two of the flush draw's outs.
+    auto spot = PackedSpot::fromPlayers(turn);
+    spot.dead = uint64_t{1} << 1 | uint64_t{1} << 2;
+    auto equity = Predictor::predictPacked(spot);
+    assert(equity.boards == 40 && equity.wins[1] < Predictor::predictPacked(PackedSpot::fromPlayers(turn)).wins[1]);
+
+    spot.dead |= uint64_t{1} << 12;
+    assert(!spot.valid());
+    spot = PackedSpot::fromPlayers(flop);
+    spot.holes[1] |= uint64_t{1} << 40;
+    assert(!spot.valid());
+
+    // A stub too small for the rest of the board, and cards a short deck does not have.
+    spot = PackedSpot::fromPlayers(flop);
+    spot.dead = StandardDeck::deckMask & ~spot.used() & ~uint64_t{1};
+    assert(!spot.valid());
+    spot = PackedSpot::fromPlayers(flop);
+    assert(spot.valid() && !spot.valid(ShortDeck::deckMask));
+
+    bool rejected = false;
+    try {
+        PackedSpot::fromPlayers(std::vector<std::vector<CardValue_52_t>>(11, {0, 1}));
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    assert(rejected);
+}
+
+void testMatchupMatrix() {
+    auto boards = MatchupMatrixGenerator::canonicalBoards();
+    uint64_t weight = 0;
+    for (const auto& board : boards)
+        weight += board.weight;
+    assert(boards.size() == MatchupMatrixGenerator::boardCount && weight == CombinationCalculator::numberOfCombinations(52, 5));
+
+    // Over the suit orbits of a few boards the averaged counts are exact for every pair.
+    boards.resize(40);
+    auto entries = MatchupMatrixGenerator::matrix(boards, 2);
+    std::vector<FastAnalyzer::Deck_t> orbits;
+    uint64_t orbitBoards = 0;
+    for (const auto& board : boards) {
+        std::array<CardSuit_t, 4> permutation{0, 1, 2, 3};
+        do {
+            orbits.push_back(MatchupMatrixGenerator::relabel(board.mask, permutation));
+        } while (std::next_permutation(permutation.begin(), permutation.end()));
+        orbitBoards += board.weight;
+    }
+    std::sort(orbits.begin(), orbits.end());
+    orbits.erase(std::unique(orbits.begin(), orbits.end()), orbits.end());
+    assert(orbits.size() == orbitBoards);
+
+    auto holding = [](const char* a, const char* b) { return Holdings::index(Card::fromString(a), Card::fromString(b)); };
+    std::vector<std::array<unsigned, 2>> pairs{{holding("As", "Ks"), holding("Qh", "Qd")}, {holding("7c", "2d"), holding("7h", "2s")},
+                                               {holding("2d", "2h"), holding("3d", "4d")}, {holding("Ac", "Kd"), holding("2d", "3d")}};
+    for (const auto& pair : pairs) {
+        const auto a = std::min(pair[0], pair[1]);
+        const auto b = std::max(pair[0], pair[1]);
+        uint32_t wins = 0, ties = 0;
+        for (auto board : orbits) {
+            if (board & (Holdings::mask(a) | Holdings::mask(b)))
+                continue;
+            auto x = FastAnalyzer::evaluate(Holdings::mask(a) | board);
+            auto y = FastAnalyzer::evaluate(Holdings::mask(b) | board);
+            wins += x > y;
+            ties += x == y;
+        }
+        const auto& entry = entries[MatchupMatrix::slot(a, b)];
+        assert(entry.wins == wins && entry.ties == ties);
+    }
+    const auto aceKing = holding("As", "Ks");
+    const auto kingQueen = holding("Ks", "Qs");
+    assert(entries[MatchupMatrix::slot(std::min(aceKing, kingQueen), std::max(aceKing, kingQueen))].wins == 0);
+
+    char path[] = "/tmp/matchupsXXXXXX";
+    auto fd = ::mkstemp(path);
+    assert(fd >= 0);
+    ::close(fd);
+    MatchupMatrixGenerator::write(path, entries);
+    MatchupMatrix matrix{path};
+    std::remove(path);
+    assert(matrix.loaded());
+    for (const auto& pair : pairs) {
+        PreflopTable::Matchup forward, backward;
+        assert(matrix.lookup(pair[0], pair[1], forward) && matrix.lookup(pair[1], pair[0], backward));
+        const auto& entry = entries[MatchupMatrix::slot(std::min(pair[0], pair[1]), std::max(pair[0], pair[1]))];
+        const auto& low = pair[0] < pair[1] ? forward : backward;
+        assert(low.wins == entry.wins && low.ties == entry.ties);
+        assert(backward.wins == forward.losses && backward.losses == forward.wins && backward.ties == forward.ties);
+        assert(std::abs(matrix.equity(pair[0], pair[1]) + matrix.equity(pair[1], pair[0]) - 1.) < 1e-12);
+    }
+    PreflopTable::Matchup blocked;
+    assert(!matrix.lookup(aceKing, kingQueen, blocked) && matrix.equity(aceKing, kingQueen) == 0.);
+}
+
+void testCounterRandom(IAnalyzer& analyzer) {
+    auto block = Philox::generate(0, 0, 0);
+    assert(block[0] == 0x6627e8d5 && block[1] == 0xe169c58d && block[2] == 0xbc57ac4c && block[3] == 0x9b00dbd8);
+    block = Philox::generate(0x299f31d0a4093822, 0x85a308d3243f6a88, 0x0370734413198a2e);
+    assert(block[0] == 0xd16cfe09 && block[1] == 0x94fdcceb && block[2] == 0x5001e420 && block[3] == 0x24126ea1);
+
+    Deck deck;
+    SampleStream stream{3, 0};
+    uint64_t dealt = 0;
+    for (auto c = 0; c < 52; ++c)
+        dealt |= uint64_t{1} << deck.deal(stream);
+    assert(dealt == (uint64_t{1} << 52) - 1);
+
+    Predictor predictor{analyzer};
+    predictor.seed(11);
+    std::vector<std::vector<CardValue_52_t>> players{{4, 12}, {2, 3}};
+    auto whole = predictor.sampleRange(players, 0, 300);
+    Equity sharded;
+    sharded.merge(predictor.sampleRange(players, 100, 200));
+    sharded.merge(predictor.sampleRange(players, 0, 100));
+    assert(sharded.boards == whole.boards && sharded.wins == whole.wins && sharded.ties == whole.ties);
+    assert(RunoutSampler{}.seed() != RunoutSampler{}.seed());
+}
+
+void testShardDriver(IAnalyzer& analyzer) {
+    char directory[] = "/tmp/shardtestXXXXXX";
+    assert(::mkdtemp(directory));
+    auto turn = Spot::fromString("AsAdKh7d2c4s,7c8cKh7d2c4s");
+    ShardDriver driver{analyzer, 2, 10};
+    auto result = driver.run(turn, directory);
+    assert(result.equity.boards == 44);
+    assert(driver.run(turn, directory).equity.wins == result.equity.wins);
+
+    // Another spot or chunk size in the same directory is refused instead of reusing shards.
+    for (auto other : {std::make_pair(Spot::fromString("AsAdKh7d2c4s,7c9cKh7d2c4s"), uint64_t{10}),
+                       std::make_pair(turn, uint64_t{20})}) {
+        bool refused = false;
+        try {
+            ShardDriver{analyzer, 1, other.second}.run(other.first, directory);
+        } catch (const std::runtime_error&) {
+            refused = true;
+        }
+        assert(refused);
+    }
+    std::system(("rm -rf " + std::string{directory}).c_str());
+
+    auto shard = ShardResult::parse(ShardResult{"AsAd,7c8c", Predictor{analyzer}.predictRange(turn, 0, 20)}.serialize());
+    ShardResult merged;
+    merged.merge(shard);
+    bool overlapping = false;
+    try {
+        merged.merge(shard);
+    } catch (const std::invalid_argument&) {
+        overlapping = true;
+    }
+    assert(overlapping && merged.equity.boards == 20);
+}
+
+void testAsyncPredictor(IAnalyzer& analyzer) {
+    ThreadPool pool{2};
+    AsyncPredictor async{analyzer, pool, 10};
+    Predictor predictor{analyzer};
+
+    std::vector<std::vector<CardValue_52_t>> players{{12, 12+13, 0, 14, 30, 45}, {11, 10, 0, 14, 30, 45}};
+    std::atomic<unsigned> updates{0};
+    auto job = async.submit(players, {}, [&updates](const EquityJob&) { ++updates; });
+    auto equity = job->future().get();
+    auto expected = predictor.predictRange(players, 0, predictor.numberOfBoards(players));
+    assert(equity.boards == expected.boards && equity.wins == expected.wins && equity.ties == expected.ties);
+    assert(job->progress() == 1. && updates >= 1);
+
+    AsyncPredictor slow{analyzer, pool};
+    auto cancelled = slow.submit({{4, 12}, {2, 3}});
+    auto future = cancelled->future();
+    cancelled->cancel();
+    try {
+        future.get();
+        assert(false);
+    } catch (const JobCancelled&) {
+    }
+    assert(cancelled->progress() < 1.);
+
+    // Throwing callbacks fail the job through its future instead of the worker thread.
+    auto throwing = async.submit(players, {}, [](const EquityJob&) { throw std::runtime_error("progress"); });
+    try {
+        throwing->future().get();
+        assert(false);
+    } catch (const std::runtime_error& e) {
+        assert(std::string{e.what()} == "progress");
+    }
+    auto failing = async.submit(players, [](const Equity&) { throw std::logic_error("done"); });
+    try {
+        failing->future().get();
+        assert(false);
+    } catch (const std::logic_error& e) {
+        assert(std::string{e.what()} == "done");
+    }
+}
+
+void testAllocSites() {
+    // Sites past the registry's capacity share a separate overflow site, never another one's.
+    static std::vector<std::string> names;
+    for (auto n = 0; n < 70; ++n)
+        names.push_back("site " + std::to_string(n));
+    std::vector<AllocAccounting::Site*> sites;
+    for (const auto& name : names)
+        sites.push_back(AllocAccounting::site(name.c_str()));
+    assert(AllocAccounting::site(names[3].c_str()) == sites[3]);
+    for (auto n = 0; n < 64; ++n)
+        assert(std::string{sites[n]->name} == names[n]);
+    assert(sites[64] == sites[69] && sites[64] != sites[63] && std::string{sites[64]->name} == "<overflow>");
+
+    {
+        AllocScope scope{sites[65]};
+    }
+    std::ostringstream report;
+    AllocAccounting::report(report);
+    assert(report.str().find("<overflow> 6 sites") != std::string::npos);
+}
+
+void testSpotCorpus(IAnalyzer& analyzer) {
+    std::istringstream text{"# recorded\nAsAdKh7d2c4s9h,7c8cKh7d2c4s9h\n\nAsAdKh7d2c4s,7c8cKh7d2c4s,QsJsKh7d2c4s\n"};
+    auto spots = SpotCorpus::parseText(text);
+    assert(spots.size() == 2);
+    auto data = SpotCorpus::encode(spots);
+    assert(data.size() == sizeof(SpotCorpus::Header) + (2 + 5 + 4) + (2 + 4 + 6));
+    assert(SpotCorpus::decode(data.data(), data.size()) == spots);
+
+    // Cards out of range or dealt twice are rejected like a malformed header.
+    for (auto corrupt : {char(52), data[sizeof(SpotCorpus::Header) + 3]}) {
+        auto broken = data;
+        broken[sizeof(SpotCorpus::Header) + 2] = corrupt;
+        bool rejected = false;
+        try {
+            SpotCorpus::decode(broken.data(), broken.size());
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+
+    // One or two board cards is no street, on either side of the file.
+    for (auto boardSize : {1, 2}) {
+        auto broken = data;
+        broken[sizeof(SpotCorpus::Header) + 1] = char(boardSize);
+        bool rejected = false;
+        try {
+            SpotCorpus::decode(broken.data(), broken.size());
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        assert(rejected);
+
+        auto partial = spots[0];
+        for (auto& hand : partial)
+            hand.resize(2 + boardSize);
+        rejected = false;
+        try {
+            SpotCorpus::encode({partial});
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+
+    ReplayDriver driver{analyzer};
+    ReplayDriver::Options options;
+    options.concurrency = 2;
+    auto report = driver.run(spots, options);
+    assert(report.spots == 2 && report.latencies.size() == 2 && report.byKind.size() == 2);
+    assert(report.byKind.count("river heads-up") && report.byKind.count("turn multiway"));
+    assert(ReplayReport::percentile(report.latencies, 0.5) == report.latencies[0]);
+    assert(ReplayReport::percentile(report.latencies, 0.999) == report.latencies[1]);
+
+    options.budget = std::chrono::milliseconds(5);
+    report = driver.run(spots, options);
+    assert(report.spots == 2 && report.latencies.size() == 2 && report.failures == 0);
+
+    // An analyzer that fails on the multiway spot's Qs: that spot is counted as failed,
+    // the other still reports, and run() returns.
+    struct FailingAnalyzer : IAnalyzer {
+        FastAnalyzer fast;
+        std::unique_ptr<Hand> analyze(const std::vector<CardValue_52_t>& cards) override {
+            if (std::find(cards.begin(), cards.end(), Card::fromString("Qs")) != cards.end())
+                throw std::runtime_error("analyzer failure");
+            return fast.analyze(cards);
+        }
+    } failing;
+    ReplayDriver failingDriver{failing};
+    options.budget = std::chrono::nanoseconds{0};
+    report = failingDriver.run(spots, options);
+    assert(report.spots == 2 && report.failures == 1 && report.latencies.size() == 1);
+    assert(report.byKind.size() == 1 && report.byKind.count("river heads-up"));
+}
+
 int main() {
     testHandComparison();
+    testAllocSites();
     testAnalyzers();
+    testExhaustiveSweep();
+    testCardParsing();
+    testCombinationRanking();
+    testPreflopTable();
+    testRandomOpponents();
+    testHandLadder();
+    testHandStrength();
+    testFlopDatabase();
+    testShortDeck();
+    testMatchupMatrix();
+    {
+        FastAnalyzer fast{};
+        testPredictRangeMerges(fast);
+        testPredictWithin(fast);
+        testCounterRandom(fast);
+        testAsyncPredictor(fast);
+        testShardDriver(fast);
+        testSpotCorpus(fast);
+        testHiLo(fast);
+        testRunItTwice(fast);
+        testPackedSpot(fast);
+    }
 
     FastAnalyzer fast{};
     Predictor predictor{fast};
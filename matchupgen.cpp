@@ -0,0 +1,31 @@
+#include "matchups.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// matchupgen <path> [threads]
+// Writes the exact heads-up results of all 1326 x 1326 pairs of holdings.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: matchupgen <path> [threads]\n";
+        return 1;
+    }
+
+    unsigned threads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+    auto tstart = std::chrono::high_resolution_clock::now();
+
+    try {
+        MatchupMatrixGenerator::generate(argv[1], threads);
+        MatchupMatrix matrix{argv[1]};
+        auto tend = std::chrono::high_resolution_clock::now();
+        std::cout << MatchupMatrix::pairs << " pairs written to " << argv[1] << " in "
+                  << std::chrono::duration_cast<std::chrono::seconds>(tend - tstart).count() << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
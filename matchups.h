@@ -0,0 +1,351 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "ladder.h"
+#include "mappedfile.h"
+#include "preflop.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Exact heads-up results of every pair of holdings, read from a memory mapped file. The
+// file is a Header followed by one Entry per pair of Holdings a < b in triangle order:
+// the wins of a and the ties over all boardsPerMatchup boards. The wins of b are what
+// is left; pairs sharing a card are all zero.
+class MatchupMatrix {
+public:
+    static constexpr uint32_t fileMagic = 0x584d5548; // "HUMX"
+    static constexpr uint32_t fileVersion = 1;
+    static constexpr uint32_t boardsPerMatchup = PreflopTable::boardsPerMatchup;
+    static constexpr size_t pairs = size_t{Holdings::count} * (Holdings::count - 1) / 2;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t holdings;
+        uint32_t boards;
+    };
+
+    struct Entry {
+        uint32_t wins;
+        uint32_t ties;
+    };
+
+    MatchupMatrix() = default;
+
+    explicit MatchupMatrix(const std::string& path) : m_file{path} {
+        if (m_file.size() < sizeof(Header))
+            throw std::runtime_error("matchup matrix too small: " + path);
+        std::memcpy(&m_header, m_file.data(), sizeof(Header));
+        if (m_header.magic != fileMagic || m_header.version != fileVersion || m_header.holdings != Holdings::count
+            || m_header.boards != boardsPerMatchup)
+            throw std::runtime_error("not a matchup matrix: " + path);
+        if (m_file.size() != sizeof(Header) + pairs * sizeof(Entry))
+            throw std::runtime_error("truncated matchup matrix: " + path);
+        m_entries = reinterpret_cast<const Entry*>(m_file.data() + sizeof(Header));
+    }
+
+    bool loaded() const { return m_entries != nullptr; }
+
+    // Hero and villain as Holdings numbers; false when they share a card.
+    bool lookup(unsigned hero, unsigned villain, PreflopTable::Matchup& matchup) const {
+        if (!loaded() || (Holdings::mask(hero) & Holdings::mask(villain)))
+            return false;
+        const auto& entry = m_entries[slot(std::min(hero, villain), std::max(hero, villain))];
+        matchup.ties = entry.ties;
+        matchup.wins = hero < villain ? entry.wins : boardsPerMatchup - entry.wins - entry.ties;
+        matchup.losses = boardsPerMatchup - matchup.wins - matchup.ties;
+        return true;
+    }
+
+    double equity(unsigned hero, unsigned villain) const {
+        PreflopTable::Matchup matchup;
+        if (!lookup(hero, villain, matchup))
+            return 0.;
+        return (matchup.wins + 0.5 * matchup.ties) / boardsPerMatchup;
+    }
+
+    // Position of the pair a < b in the file.
+    static size_t slot(unsigned a, unsigned b) {
+        const size_t n = Holdings::count;
+        return a * (2 * n - a - 1) / 2 + (b - a - 1);
+    }
+
+private:
+    MappedFile m_file;
+    Header m_header{};
+    const Entry* m_entries = nullptr;
+};
+
+// Offline builder of the matchup matrix, board first. Each suit isomorphic five card
+// board is evaluated once for all 1326 holdings and then settles every pair at once,
+// counted as many times as its suit orbit has boards. Such weighted counts are only
+// right summed over a suit orbit of pairs, so the orbits are averaged at the end, which
+// gives the exact count of every pair. Per board each pair row is a branch free pass
+// over the holdings after it, padded to whole vectors.
+class MatchupMatrixGenerator {
+public:
+    struct Board {
+        FastAnalyzer::Deck_t mask;
+        uint32_t weight;
+    };
+
+    static constexpr unsigned boardCount = 134459;
+    static constexpr unsigned suitPermutations = 24;
+
+    // One board per suit orbit, the smallest mask, weighted by the size of its orbit.
+    static std::vector<Board> canonicalBoards() {
+        const auto permutations = suitPermutationTable();
+        std::vector<Board> boards;
+        boards.reserve(boardCount);
+        auto indices = CombinationCalculator::unrank(0, 52, 5);
+        do {
+            FastAnalyzer::Deck_t board = 0;
+            for (auto c : indices)
+                board |= FastAnalyzer::Deck_t{1} << c;
+            bool canonical = true;
+            unsigned fixed = 0;
+            for (const auto& permutation : permutations) {
+                auto relabeled = relabel(board, permutation);
+                canonical &= relabeled >= board;
+                fixed += relabeled == board;
+            }
+            if (canonical)
+                boards.push_back({board, suitPermutations / fixed});
+        } while (CombinationCalculator::next(indices, 52));
+        return boards;
+    }
+
+    // Results of every pair over the suit orbits of the given boards, in file order.
+    static std::vector<MatchupMatrix::Entry> matrix(const std::vector<Board>& boards, unsigned threads) {
+        std::vector<std::unique_ptr<Counts>> counts;
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+
+        auto worker = [&]() {
+            auto local = std::make_unique<Counts>();
+            Values values;
+            for (auto b = next.fetch_add(batch); b < boards.size(); b = next.fetch_add(batch)) {
+                const auto end = std::min(b + batch, boards.size());
+                values.fill(boards, b, end);
+                local->settle(boards, b, end, values);
+            }
+            std::lock_guard<std::mutex> lock{mutex};
+            counts.push_back(std::move(local));
+        };
+
+        std::vector<std::thread> pool;
+        for (auto t = 0u; t < std::max(threads, 1u); ++t)
+            pool.emplace_back(worker);
+        for (auto& thread : pool)
+            thread.join();
+        for (auto c = 1u; c < counts.size(); ++c)
+            counts[0]->add(*counts[c]);
+
+        return averageOrbits(*counts[0]);
+    }
+
+    static void generate(const std::string& path, unsigned threads) {
+        write(path, matrix(canonicalBoards(), threads));
+    }
+
+    // Writes entries in the file format; entries from a subset of the boards make a
+    // file that loads but counts only those boards.
+    static void write(const std::string& path, const std::vector<MatchupMatrix::Entry>& entries) {
+        MatchupMatrix::Header header{MatchupMatrix::fileMagic, MatchupMatrix::fileVersion, Holdings::count,
+                                     MatchupMatrix::boardsPerMatchup};
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MatchupMatrix::Entry));
+        if (!out)
+            throw std::runtime_error("cannot write matchup matrix " + path);
+    }
+
+    static FastAnalyzer::Deck_t relabel(FastAnalyzer::Deck_t mask, const std::array<CardSuit_t, 4>& permutation) {
+        FastAnalyzer::Deck_t relabeled = 0;
+        for (auto s = 0; s < 4; ++s)
+            relabeled |= (mask >> (13 * s) & 0x1fff) << (13 * permutation[s]);
+        return relabeled;
+    }
+
+private:
+    static constexpr size_t batch = 32;
+#ifdef __AVX2__
+    static constexpr unsigned lanes = 8;
+#else
+    static constexpr unsigned lanes = 4;
+#endif
+    static constexpr unsigned padded = (Holdings::count + lanes - 1) / lanes * lanes;
+
+    using Lanes = int32_t __attribute__((vector_size(lanes * sizeof(int32_t))));
+
+    static std::array<std::array<CardSuit_t, 4>, suitPermutations> suitPermutationTable() {
+        std::array<std::array<CardSuit_t, 4>, suitPermutations> permutations;
+        std::array<CardSuit_t, 4> permutation{0, 1, 2, 3};
+        auto p = 0;
+        do {
+            permutations[p++] = permutation;
+        } while (std::next_permutation(permutation.begin(), permutation.end()));
+        return permutations;
+    }
+
+    // Row i covers the holdings from i + 1, rounded down to a whole vector, up to padded.
+    static unsigned rowStart(unsigned i) { return (i + 1) / lanes * lanes; }
+
+    // Hand values of every holding on a batch of boards. Holdings that touch the board
+    // read as beaten in the win column and as beating in the loss column, so neither
+    // counts; the padding does the same.
+    struct Values {
+        std::array<std::array<int32_t, padded>, batch> win;
+        std::array<std::array<int32_t, padded>, batch> loss;
+
+        void fill(const std::vector<Board>& boards, size_t begin, size_t end) {
+            for (auto b = begin; b < end; ++b) {
+                auto& w = win[b - begin];
+                auto& l = loss[b - begin];
+                for (auto h = 0u; h < padded; ++h) {
+                    if (h < Holdings::count && !(Holdings::mask(h) & boards[b].mask)) {
+                        w[h] = l[h] = int32_t(FastAnalyzer::evaluate(Holdings::mask(h) | boards[b].mask));
+                    } else {
+                        w[h] = INT32_MAX;
+                        l[h] = -1;
+                    }
+                }
+            }
+        }
+    };
+
+    // Weighted wins, ties and losses of row holding i against every later holding.
+    struct Counts {
+        std::array<size_t, Holdings::count + 1> offsets;
+        std::vector<uint32_t> wins;
+        std::vector<uint32_t> ties;
+        std::vector<uint32_t> losses;
+
+        Counts() {
+            offsets[0] = 0;
+            for (auto i = 0u; i < Holdings::count; ++i)
+                offsets[i + 1] = offsets[i] + padded - rowStart(i);
+            wins.assign(offsets.back(), 0);
+            ties.assign(offsets.back(), 0);
+            losses.assign(offsets.back(), 0);
+        }
+
+        size_t at(unsigned i, unsigned j) const { return offsets[i] + j - rowStart(i); }
+
+        void settle(const std::vector<Board>& boards, size_t begin, size_t end, const Values& values) {
+            for (auto i = 0u; i < Holdings::count; ++i) {
+                const auto start = rowStart(i);
+                const auto n = padded - start;
+                auto* rowWins = &wins[offsets[i]];
+                auto* rowTies = &ties[offsets[i]];
+                auto* rowLosses = &losses[offsets[i]];
+                for (auto b = begin; b < end; ++b) {
+                    const auto value = values.loss[b - begin][i];
+                    if (value < 0)
+                        continue;
+                    const uint32_t weight = boards[b].weight;
+                    const auto* win = &values.win[b - begin][start];
+                    const auto* loss = &values.loss[b - begin][start];
+                    for (auto j = 0u; j < n; j += lanes)
+                        settleLanes(value, weight, win + j, loss + j, rowWins + j, rowTies + j, rowLosses + j);
+                }
+            }
+        }
+
+        // One vector of pairs. Comparisons of vectors give all ones lanes where true,
+        // which mask the weight; counts never reach 2^31, so signed lanes are fine.
+        static void settleLanes(int32_t value, uint32_t weight, const int32_t* win, const int32_t* loss,
+                                uint32_t* wins, uint32_t* ties, uint32_t* losses) {
+            Lanes w, l, won, tied, lost;
+            std::memcpy(&w, win, sizeof(Lanes));
+            std::memcpy(&l, loss, sizeof(Lanes));
+            std::memcpy(&won, wins, sizeof(Lanes));
+            std::memcpy(&tied, ties, sizeof(Lanes));
+            std::memcpy(&lost, losses, sizeof(Lanes));
+            const Lanes v = Lanes{} + value;
+            const Lanes m = Lanes{} + int32_t(weight);
+            won += (v > w) & m;
+            tied += (v == w) & m;
+            lost += (v < l) & m;
+            std::memcpy(wins, &won, sizeof(Lanes));
+            std::memcpy(ties, &tied, sizeof(Lanes));
+            std::memcpy(losses, &lost, sizeof(Lanes));
+        }
+
+        void add(const Counts& other) {
+            for (size_t k = 0; k < wins.size(); ++k) {
+                wins[k] += other.wins[k];
+                ties[k] += other.ties[k];
+                losses[k] += other.losses[k];
+            }
+        }
+    };
+
+    // Every ordered pair of disjoint holdings belongs to a suit orbit; the smallest pair
+    // of the orbit collects the weighted counts of all its pairs and hands each of them
+    // the average.
+    static std::vector<MatchupMatrix::Entry> averageOrbits(const Counts& counts) {
+        const auto permutations = suitPermutationTable();
+        std::vector<std::array<uint16_t, Holdings::count>> images(suitPermutations);
+        for (auto p = 0u; p < suitPermutations; ++p)
+            for (auto h = 0u; h < Holdings::count; ++h) {
+                const auto& cards = Holdings::cards(h);
+                images[p][h] = Holdings::index(relabelCard(cards[0], permutations[p]), relabelCard(cards[1], permutations[p]));
+            }
+
+        std::vector<MatchupMatrix::Entry> entries(MatchupMatrix::pairs, MatchupMatrix::Entry{});
+        std::array<uint32_t, suitPermutations> orbit;
+        for (auto a = 0u; a < Holdings::count; ++a) {
+            for (auto b = 0u; b < Holdings::count; ++b) {
+                if (a == b || (Holdings::mask(a) & Holdings::mask(b)))
+                    continue;
+                const uint32_t pair = a * Holdings::count + b;
+                unsigned size = 0;
+                bool smallest = true;
+                for (auto p = 0u; p < suitPermutations && smallest; ++p) {
+                    const uint32_t image = images[p][a] * Holdings::count + images[p][b];
+                    smallest = image >= pair;
+                    orbit[size++] = image;
+                }
+                if (!smallest)
+                    continue;
+                std::sort(orbit.begin(), orbit.begin() + size);
+                size = std::unique(orbit.begin(), orbit.begin() + size) - orbit.begin();
+
+                uint64_t wins = 0, ties = 0, losses = 0;
+                for (auto o = 0u; o < size; ++o) {
+                    const auto x = orbit[o] / Holdings::count;
+                    const auto y = orbit[o] % Holdings::count;
+                    const auto k = counts.at(std::min(x, y), std::max(x, y));
+                    wins += x < y ? counts.wins[k] : counts.losses[k];
+                    losses += x < y ? counts.losses[k] : counts.wins[k];
+                    ties += counts.ties[k];
+                }
+                for (auto o = 0u; o < size; ++o) {
+                    const auto x = orbit[o] / Holdings::count;
+                    const auto y = orbit[o] % Holdings::count;
+                    auto& entry = entries[MatchupMatrix::slot(std::min(x, y), std::max(x, y))];
+                    entry.wins = uint32_t((x < y ? wins : losses) / size);
+                    entry.ties = uint32_t(ties / size);
+                }
+            }
+        }
+        return entries;
+    }
+
+    static CardValue_52_t relabelCard(CardValue_52_t card, const std::array<CardSuit_t, 4>& permutation) {
+        return CardValue_52_t(permutation[Card::suit(card)] * 13 + Card::value(card));
+    }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "predictor.h"
+#include "rng.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Equity of one hand against 1 to maxOpponents unknown hands. Every board is
+// dealt once: the hero's value is placed among the values of all holdings the
+// remaining cards allow, and the multi-way result follows from the fraction of
+// holdings it beats and ties. Opponents are treated as independent draws from
+// that distribution, which is exact heads-up and ignores the few cards opponents
+// take from each other otherwise.
+class RandomOpponents {
+public:
+    static constexpr unsigned maxOpponents = 9;
+
+    struct Result {
+        uint64_t boards = 0;
+        bool exact = false;
+        // Indexed by the number of opponents, entry 0 is unused.
+        std::array<double, maxOpponents + 1> win{};
+        std::array<double, maxOpponents + 1> share{};
+    };
+
+    RandomOpponents() = default;
+
+    // Sampled boards come from a random seed unless one is set here.
+    void seed(uint64_t seed) { m_sampler = RunoutSampler{seed}; }
+
+    // Enumerates all runouts when there are at most maxBoards of them, otherwise samples maxBoards.
+    Result predict(const std::vector<CardValue_52_t>& hero, const std::vector<CardValue_52_t>& board, uint64_t maxBoards = 20000) {
+        if (hero.size() != 2 || board.size() > 5)
+            throw std::invalid_argument("need two hole cards and at most five board cards");
+        FastAnalyzer::Deck_t heroMask = 0;
+        FastAnalyzer::Deck_t boardMask = 0;
+        for (auto card : hero)
+            heroMask |= bit(card);
+        for (auto card : board)
+            boardMask |= bit(card);
+        if (__builtin_popcountll(heroMask | boardMask) != int(hero.size() + board.size()))
+            throw std::invalid_argument("hero and board cards must be distinct");
+
+        std::vector<CardValue_52_t> cards;
+        for (auto c = 0; c < 52; ++c)
+            if (!((heroMask | boardMask) & (FastAnalyzer::Deck_t{1} << c)))
+                cards.push_back(c);
+
+        const unsigned k = 5 - board.size();
+        const auto total = CombinationCalculator::numberOfCombinations(cards.size(), k);
+
+        Result result;
+        if (total <= maxBoards) {
+            result.exact = true;
+            auto indices = CombinationCalculator::unrank(0, cards.size(), k);
+            do {
+                auto runout = boardMask;
+                for (auto i : indices)
+                    runout |= FastAnalyzer::Deck_t{1} << cards[i];
+                accumulate(heroMask, runout, result);
+            } while (CombinationCalculator::next(indices, cards.size()));
+        } else {
+            std::array<CardValue_52_t, 5> drawn;
+            for (uint64_t b = 0; b < maxBoards; ++b) {
+                m_sampler.runout(b, cards, cards.size(), k, drawn);
+                auto runout = boardMask;
+                for (auto i = 0u; i < k; ++i)
+                    runout |= FastAnalyzer::Deck_t{1} << drawn[i];
+                accumulate(heroMask, runout, result);
+            }
+        }
+
+        for (auto n = 1u; n <= maxOpponents; ++n) {
+            result.win[n] /= result.boards;
+            result.share[n] /= result.boards;
+        }
+        return result;
+    }
+
+private:
+    // A group of opponent holdings that all make the same hand on the board.
+    struct Level {
+        FastAnalyzer::Value_t value;
+        uint32_t holdings;
+    };
+
+    static FastAnalyzer::Deck_t bit(CardValue_52_t card) {
+        if (card >= 52)
+            throw std::invalid_argument("not a card: " + std::to_string(card));
+        return FastAnalyzer::Deck_t{1} << card;
+    }
+
+    // Sorted distribution of the opponent holdings the dead cards leave on a full board.
+    // Off the flush suit, if the board has one, suits do not matter: the holdings of a
+    // pair of ranks split by which of their cards are of the flush suit, and each such
+    // class is evaluated once for all its holdings, at most 364 evaluations instead of
+    // one per holding.
+    static unsigned distribution(FastAnalyzer::Deck_t board, FastAnalyzer::Deck_t dead, std::array<Level, 364>& levels) {
+        int flush = -1;
+        for (auto s = 0; s < 4; ++s)
+            if (__builtin_popcountll(board >> (13 * s) & 0x1fff) >= 3)
+                flush = s;
+
+        // Per rank, the live cards off the flush suit and the live flush card, if any.
+        std::array<FastAnalyzer::Deck_t, 13> plain{};
+        std::array<FastAnalyzer::Deck_t, 13> suited{};
+        for (auto c = 0; c < 52; ++c) {
+            if (dead & (FastAnalyzer::Deck_t{1} << c))
+                continue;
+            (Card::suit(c) == flush ? suited : plain)[Card::value(c)] |= FastAnalyzer::Deck_t{1} << c;
+        }
+
+        unsigned n = 0;
+        auto add = [&](FastAnalyzer::Deck_t first, FastAnalyzer::Deck_t second, uint32_t holdings) {
+            if (holdings == 0)
+                return;
+            auto one = first & -first;
+            auto two = (second & ~one) & -(second & ~one);
+            levels[n++] = {FastAnalyzer::evaluate(board | one | two), holdings};
+        };
+        for (auto a = 0; a < 13; ++a) {
+            const auto pa = __builtin_popcountll(plain[a]);
+            add(plain[a], plain[a], pa * (pa - 1) / 2);
+            add(suited[a], plain[a], pa * __builtin_popcountll(suited[a]));
+            for (auto b = a + 1; b < 13; ++b) {
+                const auto pb = __builtin_popcountll(plain[b]);
+                const auto sa = __builtin_popcountll(suited[a]);
+                const auto sb = __builtin_popcountll(suited[b]);
+                add(plain[a], plain[b], pa * pb);
+                add(suited[a], plain[b], sa * pb);
+                add(plain[a], suited[b], pa * sb);
+                add(suited[a], suited[b], sa * sb);
+            }
+        }
+        std::sort(levels.begin(), levels.begin() + n, [](const Level& x, const Level& y) { return x.value < y.value; });
+        return n;
+    }
+
+    void accumulate(FastAnalyzer::Deck_t hero, FastAnalyzer::Deck_t board, Result& result) {
+        const auto value = FastAnalyzer::evaluate(hero | board);
+
+        std::array<Level, 364> levels;
+        const auto n = distribution(board, hero | board, levels);
+        uint64_t holdings = 0;
+        for (auto l = 0u; l < n; ++l)
+            holdings += levels[l].holdings;
+
+        // Hero's place in the sorted distribution.
+        auto lower = std::lower_bound(levels.begin(), levels.begin() + n, value,
+                                      [](const Level& level, FastAnalyzer::Value_t v) { return level.value < v; });
+        uint64_t worse = 0;
+        uint64_t tied = 0;
+        for (auto it = levels.begin(); it != lower; ++it)
+            worse += it->holdings;
+        for (auto it = lower; it != levels.begin() + n && it->value == value; ++it)
+            tied += it->holdings;
+
+        const double pw = double(worse) / holdings;
+        const double pt = double(tied) / holdings;
+
+        // Pot share against n opponents: k of them tie with probability C(n,k) pt^k pw^(n-k)
+        // and the pot is then split k + 1 ways.
+        for (auto n = 1u; n <= maxOpponents; ++n) {
+            double share = 0.;
+            double binomial = 1.;
+            for (auto t = 0u; t <= n; ++t) {
+                share += binomial * std::pow(pt, t) * std::pow(pw, n - t) / (t + 1);
+                binomial = binomial * (n - t) / (t + 1);
+            }
+            result.win[n] += std::pow(pw, n);
+            result.share[n] += share;
+        }
+        result.boards += 1;
+    }
+
+    RunoutSampler m_sampler;
+};
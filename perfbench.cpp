@@ -0,0 +1,129 @@
+#include "alloccount.h"
+#include "analyzer.h"
+#include "fastanalyzer.h"
+#include "handstrength.h"
+#include "ingest.h"
+#include "perfcounters.h"
+#include "predictor.h"
+#include "preflop.h"
+#include "rng.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// perfbench [hands]
+// Runs every evaluator over the same reproducible set of random seven card hands,
+// and Predictor over a turn and a preflop spot, reporting counters per hand and per board,
+// then single turn and river queries through the vector and the packed API per call
+// and flop HandStrength queries.
+// Built with -DALLOC_ACCOUNTING it also prints the allocations of every instrumented
+// call site and fails when a path declared allocation free allocates.
+int main(int argc, char** argv) {
+    const uint64_t hands = argc > 1 ? std::stoull(argv[1]) : 200000;
+
+    std::vector<std::vector<CardValue_52_t>> cards(hands);
+    std::vector<FastAnalyzer::Deck_t> decks(hands);
+    RunoutSampler sampler{1};
+    std::array<CardValue_52_t, 52> all;
+    for (auto c = 0; c < 52; ++c)
+        all[c] = c;
+    for (uint64_t h = 0; h < hands; ++h) {
+        cards[h].resize(7);
+        sampler.runout(h, all, 52, 7, cards[h]);
+        for (auto card : cards[h])
+            decks[h] |= FastAnalyzer::Deck_t{1} << card;
+    }
+
+    PerfCounters counters;
+    if (!counters.available(PerfCounters::Cycles))
+        std::cerr << "hardware counters unavailable, reporting wall time only" << std::endl;
+
+    Analyzer analyzer{};
+    FastAnalyzer fast{};
+    uint64_t sink = 0;
+
+    counters.profile("Analyzer::analyze", hands, "hand", [&] {
+        for (const auto& hand : cards)
+            sink += analyzer.analyze(hand)->getRank();
+    });
+    counters.profile("FastAnalyzer::analyze", hands, "hand", [&] {
+        for (auto deck : decks)
+            sink += fast.analyze(deck)->getRank();
+    });
+    counters.profile("FastAnalyzer::evaluate", hands, "hand", [&] {
+        for (auto deck : decks)
+            sink += FastAnalyzer::evaluate(deck);
+    });
+
+    Predictor predictor{fast};
+    std::vector<std::vector<CardValue_52_t>> river{{12, 12+13, 0, 14, 30, 45}, {11, 10, 0, 14, 30, 45}};
+    std::vector<std::vector<CardValue_52_t>> preflop{{4, 12}, {2, 3}};
+    for (const auto& spot : {river, preflop}) {
+        auto boards = std::min<uint64_t>(predictor.numberOfBoards(spot), hands);
+        counters.profile("Predictor::predictRange " + std::to_string(spot[0].size()) + " cards", boards, "board", [&] {
+            sink += predictor.predictRange(spot, 0, boards).wins[0];
+        });
+    }
+
+    // Many tiny queries, where per call setup dominates: the vector API against packed masks.
+    auto showdown = river;
+    for (auto& hand : showdown)
+        hand.push_back(46);
+    const auto queries = std::max<uint64_t>(hands / 50, 1);
+    for (const auto& spot : {river, showdown}) {
+        const auto packed = PackedSpot::fromPlayers(spot);
+        const auto name = std::to_string(spot[0].size()) + " cards";
+        counters.profile("Predictor::predictRange call " + name, queries, "call", [&] {
+            for (uint64_t q = 0; q < queries; ++q)
+                sink += predictor.predictRange(spot, 0, predictor.numberOfBoards(spot)).wins[0];
+        });
+        counters.profile("Predictor::predictPacked call " + name, queries, "call", [&] {
+            for (uint64_t q = 0; q < queries; ++q)
+                sink += Predictor::predictPacked(packed).wins[0];
+        });
+    }
+
+    // A flop HandStrength query walks every turn and river against every opponent holding.
+    const auto flop = FastAnalyzer::Deck_t{1} << 0 | FastAnalyzer::Deck_t{1} << 14 | FastAnalyzer::Deck_t{1} << 30;
+    const auto hero = FastAnalyzer::Deck_t{1} << 12 | FastAnalyzer::Deck_t{1} << 25;
+    const auto strengths = std::max<uint64_t>(hands / 20000, 1);
+    counters.profile("HandStrength::compute flop", strengths, "call", [&] {
+        for (uint64_t q = 0; q < strengths; ++q)
+            sink += uint64_t(HandStrength::compute(hero, flop).ehs * 1000);
+    });
+
+    if (!AllocAccounting::enabled) {
+        std::cerr << "allocation accounting disabled, rebuild with -DALLOC_ACCOUNTING" << std::endl;
+        return sink == 42 ? 1 : 0;
+    }
+
+    const auto villain = FastAnalyzer::Deck_t{1} << 11 | FastAnalyzer::Deck_t{1} << 10;
+    const std::string_view line = "7 Ad Kd Qd 2c 3h | As Ah | 7c 8c";
+
+    auto clean = true;
+    clean &= AllocAccounting::expectNoAllocations("FastAnalyzer::evaluate", [&] {
+        for (auto deck : decks)
+            sink += FastAnalyzer::evaluate(deck);
+    });
+    clean &= AllocAccounting::expectNoAllocations("HandStrength::compute", [&] {
+        sink += uint64_t(HandStrength::compute(hero, flop).ehs * 1000);
+    });
+    clean &= AllocAccounting::expectNoAllocations("HandHistoryParser::parseLine", [&] {
+        ParsedHand hand;
+        for (auto i = 0; i < 1000; ++i)
+            sink += HandHistoryParser::parseLine(line, hand);
+    });
+    clean &= AllocAccounting::expectNoAllocations("PreflopTableGenerator::headsUp", [&] {
+        sink += PreflopTableGenerator::headsUp(hero, villain).wins;
+    });
+
+    clean &= AllocAccounting::expectNoAllocations("Predictor::predictPacked", [&] {
+        sink += Predictor::predictPacked(PackedSpot::fromPlayers(river)).wins[0];
+    });
+
+    AllocAccounting::report();
+    if (!clean)
+        return 1;
+    return sink == 42 ? 1 : 0;
+}
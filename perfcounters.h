@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware counters of the calling thread through perf_event_open. Every event is
+// opened on its own, so a CPU or VM lacking one of them, or a kernel refusing
+// access altogether, only leaves those counters unavailable; wall time is always measured.
+class PerfCounters {
+public:
+    enum Event {
+        Cycles = 0,
+        Instructions,
+        BranchMisses,
+        L1Misses,
+        LLCMisses,
+        EventCount
+    };
+
+    struct Sample {
+        double nanoseconds = 0.;
+        std::array<int64_t, EventCount> counts{};
+        std::array<bool, EventCount> available{};
+
+        double ipc() const {
+            if (!available[Cycles] || !available[Instructions] || counts[Cycles] == 0)
+                return 0.;
+            return double(counts[Instructions]) / counts[Cycles];
+        }
+    };
+
+    PerfCounters() {
+        m_fds.fill(-1);
+#ifdef __linux__
+        const std::array<std::pair<uint32_t, uint64_t>, EventCount> events{{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        }};
+
+        for (auto e = 0; e < EventCount; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = events[e].first;
+            attr.config = events[e].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            m_fds[e] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (auto fd : m_fds)
+            if (fd >= 0)
+                ::close(fd);
+#endif
+    }
+
+    bool available(Event e) const { return m_fds[e] >= 0; }
+
+    void start() {
+#ifdef __linux__
+        for (auto fd : m_fds) {
+            if (fd >= 0) {
+                ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    Sample stop() {
+        Sample sample;
+        auto end = std::chrono::steady_clock::now();
+#ifdef __linux__
+        for (auto e = 0; e < EventCount; ++e) {
+            if (m_fds[e] < 0)
+                continue;
+            ::ioctl(m_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            // With more events than hardware counters the kernel multiplexes them, so
+            // each count is scaled up by the share of time it was actually counting.
+            // A counter that never got scheduled is reported as unavailable.
+            struct {
+                uint64_t value;
+                uint64_t enabled;
+                uint64_t running;
+            } reading{};
+            if (::read(m_fds[e], &reading, sizeof(reading)) == sizeof(reading) && reading.running > 0) {
+                sample.counts[e] = int64_t(double(reading.value) * reading.enabled / reading.running);
+                sample.available[e] = true;
+            }
+        }
+#endif
+        sample.nanoseconds = std::chrono::duration<double, std::nano>(end - m_start).count();
+        return sample;
+    }
+
+    // Runs fn once under the counters and prints the totals divided by the given
+    // number of units (hands, boards...).
+    template<typename Fn>
+    Sample profile(const std::string& name, uint64_t units, const std::string& unit, Fn&& fn) {
+        start();
+        fn();
+        auto sample = stop();
+        report(name, units, unit, sample);
+        return sample;
+    }
+
+    static void report(const std::string& name, uint64_t units, const std::string& unit, const Sample& sample,
+                       std::ostream& out = std::cout) {
+        const char* names[EventCount] = {"cycles", "instructions", "branch-misses", "L1-misses", "LLC-misses"};
+        const double per = units ? double(units) : 1.;
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+
+        out << name << ": " << units << ' ' << unit << "s, " << std::fixed << std::setprecision(1)
+            << sample.nanoseconds / per << " ns/" << unit;
+        for (auto e = 0; e < EventCount; ++e) {
+            out << ", " << names[e] << ' ';
+            if (sample.available[e])
+                out << std::setprecision(2) << sample.counts[e] / per << '/' << unit;
+            else
+                out << "n/a";
+        }
+        if (sample.ipc() > 0.)
+            out << ", IPC " << std::setprecision(2) << sample.ipc();
+        out << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    std::array<int, EventCount> m_fds;
+    std::chrono::steady_clock::time_point m_start;
+};
@@ -1,15 +1,29 @@
+#pragma once
+
 #include "analyzer.h"
 #include "card.h"
-
+#include "fastanalyzer.h"
+#include "preflop.h"
+#include "rng.h"
 #ifdef DEBUG
+#include "perfcounters.h"
+#endif
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <iostream>
-#endif
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 class CombinationCalculator {
 public:
     static std::vector<std::vector<CardValue_52_t>> calculate(const std::vector<CardValue_52_t>& cards, const unsigned selectionSize) {
+        ALLOC_SCOPE("CombinationCalculator::calculate");
         auto combinationNumber = numberOfCombinations(cards.size(), selectionSize);
         std::vector<std::vector<CardValue_52_t>> combinations;
         combinations.reserve(combinationNumber);
@@ -18,17 +32,68 @@ public:
         return combinations;
     }
 
-private:
     static uint64_t numberOfCombinations(const unsigned n, const unsigned k) {
-        auto factorial = [](unsigned begin, unsigned end) {
-            uint64_t f = begin;
-            for (auto i = begin + 1; i <= end; ++i)
-                f *= i;
-            return f;
-        };
-        return factorial(n-k+1, n) / factorial(1, k);
+        static const auto table = binomialTable();
+        if (k > n)
+            return 0;
+        return table[n][k];
+    }
+
+    // Combinations are ranked in the lexicographic order calculate() produces them in,
+    // as ascending index lists into the card vector.
+    static uint64_t rank(const std::vector<unsigned>& indices, const unsigned n) {
+        const unsigned k = indices.size();
+        uint64_t r = 0;
+        unsigned first = 0;
+        for (auto i = 0u; i < k; ++i) {
+            for (auto c = first; c < indices[i]; ++c)
+                r += numberOfCombinations(n - c - 1, k - i - 1);
+            first = indices[i] + 1;
+        }
+        return r;
+    }
+
+    static std::vector<unsigned> unrank(uint64_t r, const unsigned n, const unsigned k) {
+        std::vector<unsigned> indices;
+        indices.reserve(k);
+        unsigned c = 0;
+        for (auto i = 0u; i < k; ++i) {
+            while (true) {
+                auto below = numberOfCombinations(n - c - 1, k - i - 1);
+                if (r < below)
+                    break;
+                r -= below;
+                ++c;
+            }
+            indices.push_back(c++);
+        }
+        return indices;
     }
 
+    // Advances to the lexicographically next combination, false after the last one.
+    static bool next(std::vector<unsigned>& indices, const unsigned n) {
+        const unsigned k = indices.size();
+        for (int i = k - 1; i >= 0; --i) {
+            if (indices[i] < n - k + i) {
+                ++indices[i];
+                for (unsigned j = i + 1; j < k; ++j)
+                    indices[j] = indices[j - 1] + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static std::array<std::array<uint64_t, 53>, 53> binomialTable() {
+        std::array<std::array<uint64_t, 53>, 53> table{};
+        for (auto n = 0; n < 53; ++n) {
+            table[n][0] = 1;
+            for (auto k = 1; k <= n; ++k)
+                table[n][k] = table[n-1][k-1] + table[n-1][k];
+        }
+        return table;
+    }
 
     static void calculate(const unsigned k, const std::vector<CardValue_52_t>& cards, std::vector<std::vector<CardValue_52_t>>& combinations, 
                           std::vector<CardValue_52_t>& combination, unsigned index = 0)
@@ -46,40 +111,626 @@ private:
     }
 };
 
-class Predictor {
+// Win and split counts over a contiguous range of boards. Results over disjoint
+// ranges of the same spot add up exactly; merging overlapping ranges throws.
+struct Equity {
+    uint64_t begin = 0;
+    uint64_t boards = 0;
+    std::vector<uint64_t> wins;
+    std::vector<uint64_t> ties;
+    // Sorted disjoint [first, second) ranges once results have been merged; empty for a
+    // single range, which is then [begin, begin + boards).
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+    void merge(const Equity& other) {
+        auto covered = spans();
+        for (const auto& range : other.spans()) {
+            auto after = std::lower_bound(covered.begin(), covered.end(), range);
+            if ((after != covered.end() && after->first < range.second)
+                || (after != covered.begin() && std::prev(after)->second > range.first))
+                throw std::invalid_argument("cannot merge overlapping board ranges");
+            covered.insert(after, range);
+        }
+        ranges.clear();
+        for (const auto& range : covered) {
+            if (!ranges.empty() && ranges.back().second == range.first)
+                ranges.back().second = range.second;
+            else
+                ranges.push_back(range);
+        }
+
+        if (boards == 0)
+            begin = other.begin;
+        else
+            begin = std::min(begin, other.begin);
+        boards += other.boards;
+        wins.resize(std::max(wins.size(), other.wins.size()), 0);
+        ties.resize(std::max(ties.size(), other.ties.size()), 0);
+        for (size_t p = 0; p < other.wins.size(); ++p) {
+            wins[p] += other.wins[p];
+            ties[p] += other.ties[p];
+        }
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> spans() const {
+        if (!ranges.empty() || boards == 0)
+            return ranges;
+        return {{begin, begin + boards}};
+    }
+};
+
+// Result of a time boxed prediction: exact counts when the whole board space fit in
+// the budget, otherwise counts over uniformly sampled boards with standard errors.
+struct Estimate {
+    Equity equity;
+    bool exact = false;
+
+    double winRate(unsigned player) const {
+        return equity.boards ? double(equity.wins[player]) / equity.boards : 0.;
+    }
+
+    // Standard error of winRate, treating each board as a win or not; ties are
+    // counted as losses, so it says nothing about the error of tie shares.
+    double winError(unsigned player) const {
+        if (exact)
+            return 0.;
+        if (equity.boards < 2)
+            return 1.;
+        auto p = winRate(player);
+        return std::sqrt(p * (1 - p) / (equity.boards - 1));
+    }
+};
+
+// Hi/lo split pot results over a contiguous range of boards. Half the pot goes to the
+// best high hands and half to the best 8-or-better lows, or all of it to the high hands
+// when nobody has a low. Pot shares are counted in 1/potUnits of a pot, which every
+// split up to ten ways divides evenly, so ranges add up exactly.
+struct HiLoEquity {
+    static constexpr uint64_t potUnits = 5040;
+    static constexpr unsigned maxPlayers = 10;
+
+    uint64_t begin = 0;
+    uint64_t boards = 0;
+    uint64_t lowBoards = 0;
+    std::vector<uint64_t> highWins;
+    std::vector<uint64_t> lowWins;
+    std::vector<uint64_t> scoops;
+    std::vector<uint64_t> shares;
+
+    double share(unsigned player) const {
+        return boards ? double(shares[player]) / (potUnits * boards) : 0.;
+    }
+
+    void merge(const HiLoEquity& other) {
+        if (boards == 0)
+            begin = other.begin;
+        else
+            begin = std::min(begin, other.begin);
+        boards += other.boards;
+        lowBoards += other.lowBoards;
+        const auto players = std::max(shares.size(), other.shares.size());
+        for (auto* counts : {&highWins, &lowWins, &scoops, &shares})
+            counts->resize(players, 0);
+        for (auto p = 0u; p < other.shares.size(); ++p) {
+            highWins[p] += other.highWins[p];
+            lowWins[p] += other.lowWins[p];
+            scoops[p] += other.scoops[p];
+            shares[p] += other.shares[p];
+        }
+    }
+};
+
+// Pot shares when the rest of the board is run several times. Every run deals its own
+// runout from the stub the earlier runs left and is worth an equal part of the pot. A
+// deal is one set of disjoint runouts, one per run; shares are counted in 1/potUnits of
+// a run's pot, so deal ranges add up exactly like Equity.
+struct MultiBoardEquity {
+    static constexpr uint64_t potUnits = 2520;
+    static constexpr unsigned maxPlayers = 10;
+
+    unsigned runs = 0;
+    uint64_t begin = 0;
+    uint64_t deals = 0;
+    std::vector<std::vector<uint64_t>> boardShares;
+    std::vector<uint64_t> shares;
+    std::vector<uint64_t> scoops;
+
+    // Share of the pot of one run, and of the whole pot over all runs.
+    double boardShare(unsigned run, unsigned player) const {
+        return deals ? double(boardShares[run][player]) / (potUnits * deals) : 0.;
+    }
+
+    double share(unsigned player) const {
+        return deals ? double(shares[player]) / (potUnits * runs * deals) : 0.;
+    }
+
+    void merge(const MultiBoardEquity& other) {
+        if (deals == 0)
+            begin = other.begin;
+        else
+            begin = std::min(begin, other.begin);
+        deals += other.deals;
+        runs = std::max(runs, other.runs);
+        const auto players = std::max(shares.size(), other.shares.size());
+        boardShares.resize(runs);
+        for (auto& run : boardShares)
+            run.resize(players, 0);
+        shares.resize(players, 0);
+        scoops.resize(players, 0);
+        for (auto r = 0u; r < other.boardShares.size(); ++r)
+            for (auto p = 0u; p < other.boardShares[r].size(); ++p)
+                boardShares[r][p] += other.boardShares[r][p];
+        for (auto p = 0u; p < other.shares.size(); ++p) {
+            shares[p] += other.shares[p];
+            scoops[p] += other.scoops[p];
+        }
+    }
+};
+
+// A spot as card masks of fixed capacity, for callers issuing many small queries: the
+// hole cards of every player, the shared board and dead cards known to be out of the deck.
+struct PackedSpot {
+    static constexpr unsigned maxPlayers = 10;
+
+    std::array<uint64_t, maxPlayers> holes{};
+    unsigned players = 0;
+    uint64_t board = 0;
+    uint64_t dead = 0;
+
+    void add(uint64_t hole) {
+        if (players == maxPlayers)
+            throw std::invalid_argument("a packed spot holds at most " + std::to_string(maxPlayers) + " players");
+        holes[players++] = hole;
+    }
+
+    uint64_t used() const {
+        uint64_t cards = board | dead;
+        for (auto p = 0u; p < players; ++p)
+            cards |= holes[p];
+        return cards;
+    }
+
+    // Two to ten players of two hole cards each, at most five board cards, no card in two
+    // places and none outside the deck: every mask is ANDed against the union of the ones
+    // before it. The stub left must still hold the rest of the board.
+    bool valid(uint64_t deckMask = StandardDeck::deckMask) const {
+        if (players < 2 || players > maxPlayers || __builtin_popcountll(board) > 5)
+            return false;
+        uint64_t seen = board | dead;
+        uint64_t overlap = board & dead;
+        for (auto p = 0u; p < players; ++p) {
+            if (__builtin_popcountll(holes[p]) != 2)
+                return false;
+            overlap |= seen & holes[p];
+            seen |= holes[p];
+        }
+        return overlap == 0 && (seen & ~deckMask) == 0
+            && __builtin_popcountll(deckMask & ~seen) >= 5 - __builtin_popcountll(board);
+    }
+
+    // From Predictor's form: every player's two hole cards followed by the board.
+    static PackedSpot fromPlayers(const std::vector<std::vector<CardValue_52_t>>& playerHands) {
+        auto bit = [](CardValue_52_t card) {
+            if (card >= 52)
+                throw std::invalid_argument("not a card: " + std::to_string(card));
+            return uint64_t{1} << card;
+        };
+        PackedSpot spot;
+        for (const auto& hand : playerHands) {
+            uint64_t hole = 0;
+            for (size_t i = 0; i < std::min<size_t>(hand.size(), 2); ++i)
+                hole |= bit(hand[i]);
+            spot.add(hole);
+        }
+        for (size_t i = 2; !playerHands.empty() && i < playerHands[0].size(); ++i)
+            spot.board |= bit(playerHands[0][i]);
+        return spot;
+    }
+};
+
+// Equity of a PackedSpot, in place without allocating.
+struct PackedEquity {
+    uint64_t boards = 0;
+    std::array<uint64_t, PackedSpot::maxPlayers> wins{};
+    std::array<uint64_t, PackedSpot::maxPlayers> ties{};
+};
+
+// Equity by enumerating or sampling boards out of the cards of a deck variant. The
+// analyzer must be one for the same variant, e.g. ShortDeckAnalyzer for ShortDeckPredictor.
+template<typename Variant>
+class BasicPredictor {
 public:
-    Predictor(IAnalyzer& analyzer) : m_analyzer{analyzer} {}
+    using Evaluator = BasicFastAnalyzer<Variant>;
+
+    BasicPredictor(IAnalyzer& analyzer) : m_analyzer{analyzer} {}
+
+    // Full heads-up preflop runs are answered from the table instead of enumerating.
+    void usePreflopTable(const PreflopTable& table) { m_preflopTable = &table; }
+
+    // Whole board space of a heads-up preflop spot from the table, if one is set and has it.
+    bool lookupPreflop(const std::vector<std::vector<CardValue_52_t>>& players, Equity& equity) const {
+        if (!std::is_same<Variant, StandardDeck>::value || !m_preflopTable || players.size() != 2 || players[0].size() != 2 || players[1].size() != 2)
+            return false;
+
+        PreflopTable::Matchup matchup;
+        if (!m_preflopTable->lookup({players[0][0], players[0][1]}, {players[1][0], players[1][1]}, matchup))
+            return false;
+
+        equity.boards = PreflopTable::boardsPerMatchup;
+        equity.wins = {matchup.wins, matchup.losses};
+        equity.ties = {matchup.ties, matchup.ties};
+        return true;
+    }
 
     void predict(const std::vector<std::vector<CardValue_52_t>>& playerHands) {
+        ALLOC_SCOPE("Predictor::predict");
 #ifdef DEBUG
-        auto tstart = std::chrono::high_resolution_clock::now();
+        PerfCounters counters;
+        counters.start();
 #endif
 
-        auto cards = getAvailableCards(playerHands);
-        auto combinations = CombinationCalculator::calculate(cards, 7 - playerHands[0].size());
-        std::vector<unsigned> wins(playerHands.size(), 0);
-        // std::vector<unsigned> ties(playerHands.size(), 0);
-
-        for (auto& combination : combinations) {
-            auto winner = comparePlayerHandsForCombination(playerHands, combination);
-            if (winner >= 0)
-                wins[winner] += 1;
-        }
+        auto equity = predictRange(playerHands, 0, numberOfBoards(playerHands));
 
         for (auto p = 0; p < playerHands.size(); ++p) {
-            std::cout << "player "<< p << ": " << 100. * wins[p] / combinations.size() << "%" << std::endl;
+            std::cout << "player "<< p << ": " << 100. * equity.wins[p] / equity.boards << "%" << std::endl;
         }
 
 #ifdef DEBUG
-        auto tend = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(tend - tstart);
-        std::cout << "combination analysis takes " << duration.count() << " ms\n";
+        auto sample = counters.stop();
+        std::cout << "combination analysis takes " << uint64_t(sample.nanoseconds / 1e6) << " ms\n";
+        PerfCounters::report("predict", equity.boards, "board", sample);
 #endif
     }
 
+    uint64_t numberOfBoards(const std::vector<std::vector<CardValue_52_t>>& playerHands) {
+        auto cards = getAvailableCards(playerHands);
+        return CombinationCalculator::numberOfCombinations(cards.size(), 7 - playerHands[0].size());
+    }
+
+    static uint64_t numberOfBoards(const PackedSpot& spot) {
+        const auto stub = __builtin_popcountll(Variant::deckMask & ~spot.used());
+        return CombinationCalculator::numberOfCombinations(stub, 5 - __builtin_popcountll(spot.board));
+    }
+
+    // Every board of a packed spot, without allocating. The stub is the deck mask minus
+    // every used card, and each player's hole cards are merged with the board once.
+    static PackedEquity predictPacked(const PackedSpot& spot) {
+        ALLOC_SCOPE("Predictor::predictPacked");
+        if (!spot.valid(Variant::deckMask))
+            throw std::invalid_argument("invalid packed spot");
+
+        std::array<CardValue_52_t, 52> cards;
+        unsigned n = 0;
+        for (auto stub = Variant::deckMask & ~spot.used(); stub; stub &= stub - 1)
+            cards[n++] = __builtin_ctzll(stub);
+        const unsigned k = 5 - __builtin_popcountll(spot.board);
+
+        std::array<typename Evaluator::Deck_t, PackedSpot::maxPlayers> known;
+        for (auto p = 0u; p < spot.players; ++p)
+            known[p] = spot.holes[p] | spot.board;
+
+        std::array<unsigned, 5> indices;
+        for (auto i = 0u; i < k; ++i)
+            indices[i] = i;
+
+        PackedEquity equity;
+        while (true) {
+            typename Evaluator::Deck_t runout = 0;
+            for (auto i = 0u; i < k; ++i)
+                runout |= typename Evaluator::Deck_t{1} << cards[indices[i]];
+
+            typename Evaluator::Value_t best = 0;
+            uint32_t winners = 0;
+            for (auto p = 0u; p < spot.players; ++p) {
+                const auto value = Evaluator::evaluate(known[p] | runout);
+                if (p == 0 || value > best) {
+                    best = value;
+                    winners = 1u << p;
+                } else if (value == best) {
+                    winners |= 1u << p;
+                }
+            }
+            if ((winners & (winners - 1)) == 0)
+                equity.wins[__builtin_ctz(winners)] += 1;
+            else
+                for (auto w = winners; w; w &= w - 1)
+                    equity.ties[__builtin_ctz(w)] += 1;
+            equity.boards += 1;
+
+            int i = int(k) - 1;
+            while (i >= 0 && indices[i] == n - k + i)
+                --i;
+            if (i < 0)
+                break;
+            ++indices[i];
+            for (auto j = i + 1; j < int(k); ++j)
+                indices[j] = indices[j - 1] + 1;
+        }
+        return equity;
+    }
+
+    // Evaluates boards [begin, begin + count) in CombinationCalculator order.
+    Equity predictRange(const std::vector<std::vector<CardValue_52_t>>& playerHands, uint64_t begin, uint64_t count) {
+        ALLOC_SCOPE("Predictor::predictRange");
+        auto cards = getAvailableCards(playerHands);
+        const unsigned n = cards.size();
+        const unsigned k = 7 - playerHands[0].size();
+
+        Equity equity;
+        equity.begin = begin;
+        equity.wins.resize(playerHands.size(), 0);
+        equity.ties.resize(playerHands.size(), 0);
+
+        auto total = CombinationCalculator::numberOfCombinations(n, k);
+        if (begin >= total)
+            return equity;
+        count = std::min(count, total - begin);
+
+        if (begin == 0 && count == total && lookupPreflop(playerHands, equity))
+            return equity;
+
+        auto indices = CombinationCalculator::unrank(begin, n, k);
+        std::vector<CardValue_52_t> combination;
+        combination.reserve(7);
+        std::vector<unsigned> winners;
+
+        for (uint64_t b = 0; b < count; ++b) {
+            combination.clear();
+            for (auto i : indices)
+                combination.push_back(cards[i]);
+
+            comparePlayerHandsForCombination(playerHands, combination, winners);
+            tally(winners, equity);
+
+            CombinationCalculator::next(indices, n);
+        }
+
+        equity.boards = count;
+        return equity;
+    }
+
+    // Hi/lo split pot over boards [begin, begin + count) in CombinationCalculator order.
+    // High and low are both read from FastAnalyzer's rank masks, so every board costs
+    // one pass over the players whatever the analyzer this predictor was built with.
+    HiLoEquity predictHiLoRange(const std::vector<std::vector<CardValue_52_t>>& playerHands, uint64_t begin, uint64_t count) {
+        if (playerHands.empty() || playerHands.size() > HiLoEquity::maxPlayers)
+            throw std::invalid_argument("hi/lo splits need 1 to " + std::to_string(HiLoEquity::maxPlayers) + " players");
+        auto cards = getAvailableCards(playerHands);
+        const unsigned n = cards.size();
+        const unsigned k = 7 - playerHands[0].size();
+
+        HiLoEquity equity;
+        equity.begin = begin;
+        for (auto* counts : {&equity.highWins, &equity.lowWins, &equity.scoops, &equity.shares})
+            counts->resize(playerHands.size(), 0);
+
+        auto total = CombinationCalculator::numberOfCombinations(n, k);
+        if (begin >= total)
+            return equity;
+        count = std::min(count, total - begin);
+
+        const auto holes = holeMasks(playerHands);
+
+        auto indices = CombinationCalculator::unrank(begin, n, k);
+        for (uint64_t b = 0; b < count; ++b) {
+            typename Evaluator::Deck_t board = 0;
+            for (auto i : indices)
+                board |= typename Evaluator::Deck_t{1} << cards[i];
+            settleHiLo(holes, board, equity);
+            CombinationCalculator::next(indices, n);
+        }
+
+        equity.boards = count;
+        return equity;
+    }
+
+    // Deals of runs disjoint runouts, the first run's runout varying slowest. Throws when
+    // the runouts do not fit in the stub or the count overflows, as it does preflop from
+    // four runs on; sample those with sampleRuns.
+    uint64_t numberOfDeals(const std::vector<std::vector<CardValue_52_t>>& playerHands, unsigned runs) {
+        checkRunPlayers(playerHands);
+        const unsigned n = getAvailableCards(playerHands).size();
+        const unsigned k = 7 - playerHands[0].size();
+        if (runs == 0 || runs * k > n)
+            throw std::invalid_argument("cannot run the board " + std::to_string(runs) + " times");
+        uint64_t deals = 1;
+        for (auto r = 0u; r < runs; ++r)
+            if (__builtin_mul_overflow(deals, CombinationCalculator::numberOfCombinations(n - r * k, k), &deals))
+                throw std::overflow_error("too many deals to enumerate");
+        return deals;
+    }
+
+    // Evaluates deals [begin, begin + count) of the board run runs times. Each deal is
+    // numbered in mixed radix, one CombinationCalculator rank per run over the cards the
+    // earlier runs left; when a run advances only the runs after it are dealt again.
+    MultiBoardEquity predictRunsRange(const std::vector<std::vector<CardValue_52_t>>& playerHands, unsigned runs,
+                                      uint64_t begin, uint64_t count) {
+        ALLOC_SCOPE("Predictor::predictRunsRange");
+        checkRunPlayers(playerHands);
+        const auto total = numberOfDeals(playerHands, runs);
+        const unsigned k = 7 - playerHands[0].size();
+        auto equity = emptyRuns(playerHands, runs, begin);
+        if (begin >= total)
+            return equity;
+        count = std::min(count, total - begin);
+
+        std::vector<std::vector<CardValue_52_t>> stubs(runs + 1);
+        std::vector<std::vector<unsigned>> indices(runs);
+        std::vector<typename Evaluator::Deck_t> boards(runs, 0);
+        stubs[0] = getAvailableCards(playerHands);
+
+        auto rest = begin;
+        std::vector<uint64_t> digits(runs);
+        for (int r = runs - 1; r >= 0; --r) {
+            const auto radix = CombinationCalculator::numberOfCombinations(stubs[0].size() - r * k, k);
+            digits[r] = rest % radix;
+            rest /= radix;
+        }
+        for (auto r = 0u; r < runs; ++r) {
+            indices[r] = CombinationCalculator::unrank(digits[r], stubs[r].size(), k);
+            dealRun(stubs, indices, boards, r);
+        }
+
+        const auto holes = holeMasks(playerHands);
+        for (uint64_t d = 0; d < count; ++d) {
+            settleRuns(holes, boards, equity);
+
+            int r = runs - 1;
+            while (r >= 0 && !CombinationCalculator::next(indices[r], stubs[r].size()))
+                --r;
+            if (r < 0)
+                break;
+            for (auto level = unsigned(r); level < runs; ++level) {
+                if (level > unsigned(r))
+                    for (auto i = 0u; i < k; ++i)
+                        indices[level][i] = i;
+                dealRun(stubs, indices, boards, level);
+            }
+        }
+
+        equity.deals = count;
+        return equity;
+    }
+
+    // Evaluates sampled deals [begin, begin + count): sample i draws runs runouts at once
+    // from the stub and splits them in order, so it shards and merges like sampleRange.
+    MultiBoardEquity sampleRuns(const std::vector<std::vector<CardValue_52_t>>& playerHands, unsigned runs,
+                                uint64_t begin, uint64_t count) {
+        ALLOC_SCOPE("Predictor::sampleRuns");
+        checkRunPlayers(playerHands);
+        auto cards = getAvailableCards(playerHands);
+        const unsigned k = 7 - playerHands[0].size();
+        if (runs == 0 || runs * k > cards.size())
+            throw std::invalid_argument("cannot run the board " + std::to_string(runs) + " times");
+
+        auto equity = emptyRuns(playerHands, runs, begin);
+        const auto holes = holeMasks(playerHands);
+        std::vector<CardValue_52_t> runout(runs * k);
+        std::vector<typename Evaluator::Deck_t> boards(runs);
+
+        for (auto sample = begin; sample < begin + count; ++sample) {
+            m_sampler.runout(sample, cards, cards.size(), runs * k, runout);
+            for (auto r = 0u; r < runs; ++r) {
+                boards[r] = 0;
+                for (auto i = 0u; i < k; ++i)
+                    boards[r] |= typename Evaluator::Deck_t{1} << runout[r * k + i];
+            }
+            settleRuns(holes, boards, equity);
+        }
+
+        equity.deals = count;
+        return equity;
+    }
+
+    // Anytime prediction within a latency budget. Answers from the preflop table when it
+    // can, enumerates exactly if the board count times the measured per hand cost fits
+    // in what is left of the budget, and samples boards until the deadline otherwise. The first call on a predictor spends part of
+    // the budget timing calibrationBoards boards; sampling always runs at least one
+    // chunk of samplesPerClockCheck boards, so a tiny budget can be overrun by that much.
+    Estimate predictWithin(const std::vector<std::vector<CardValue_52_t>>& playerHands, std::chrono::nanoseconds budget) {
+        using Clock = std::chrono::steady_clock;
+        const auto deadline = Clock::now() + budget;
+        const auto total = numberOfBoards(playerHands);
+        const auto hands = playerHands.size();
+
+        Estimate estimate;
+        if (lookupPreflop(playerHands, estimate.equity)) {
+            estimate.exact = true;
+            return estimate;
+        }
+        if (m_nsPerHand <= 0.) {
+            auto tstart = Clock::now();
+            estimate.equity = predictRange(playerHands, 0, std::min<uint64_t>(total, calibrationBoards));
+            measure(Clock::now() - tstart, estimate.equity.boards * hands);
+        } else {
+            estimate.equity.wins.resize(hands, 0);
+            estimate.equity.ties.resize(hands, 0);
+        }
+
+        const auto remaining = total - estimate.equity.boards;
+        const auto left = std::chrono::duration<double, std::nano>(deadline - Clock::now()).count();
+        if (remaining * hands * m_nsPerHand <= left * budgetMargin) {
+            auto tstart = Clock::now();
+            estimate.equity.merge(predictRange(playerHands, estimate.equity.boards, remaining));
+            measure(Clock::now() - tstart, remaining * hands);
+            estimate.exact = true;
+            return estimate;
+        }
+
+        estimate.equity = sampleUntil(playerHands, deadline);
+        return estimate;
+    }
+
+    // Evaluates sampled boards [begin, begin + count). Sample i is the same board for a
+    // given seed in every thread and process, so sample ranges shard and merge exactly
+    // like predictRange results.
+    Equity sampleRange(const std::vector<std::vector<CardValue_52_t>>& playerHands, uint64_t begin, uint64_t count) {
+        ALLOC_SCOPE("Predictor::sampleRange");
+        auto cards = getAvailableCards(playerHands);
+        Equity equity;
+        equity.begin = begin;
+        equity.wins.resize(playerHands.size(), 0);
+        equity.ties.resize(playerHands.size(), 0);
+        sampleBoards(playerHands, cards, begin, count, equity);
+        return equity;
+    }
+
+    // Samples are drawn from a random seed unless one is set; processes sharing
+    // sampleRange work must set the same one.
+    void seed(uint64_t seed) { m_sampler = RunoutSampler{seed}; }
+
 private:
+    static constexpr uint64_t calibrationBoards = 256;
+    static constexpr double budgetMargin = 0.8;
+    static constexpr unsigned samplesPerClockCheck = 32;
+
+    // Running average of the cost of analyzing one player's hand on one board.
+    void measure(std::chrono::steady_clock::duration elapsed, uint64_t hands) {
+        if (hands == 0)
+            return;
+        auto ns = std::chrono::duration<double, std::nano>(elapsed).count() / hands;
+        m_nsPerHand = m_nsPerHand > 0. ? 0.75 * m_nsPerHand + 0.25 * ns : ns;
+    }
+
+    Equity sampleUntil(const std::vector<std::vector<CardValue_52_t>>& playerHands,
+                       std::chrono::steady_clock::time_point deadline) {
+        auto tstart = std::chrono::steady_clock::now();
+        auto cards = getAvailableCards(playerHands);
+
+        Equity equity;
+        equity.wins.resize(playerHands.size(), 0);
+        equity.ties.resize(playerHands.size(), 0);
+
+        do {
+            sampleBoards(playerHands, cards, equity.boards, samplesPerClockCheck, equity);
+        } while (std::chrono::steady_clock::now() < deadline);
+
+        measure(std::chrono::steady_clock::now() - tstart, equity.boards * playerHands.size());
+        return equity;
+    }
+
+    void sampleBoards(const std::vector<std::vector<CardValue_52_t>>& playerHands, const std::vector<CardValue_52_t>& cards,
+                      uint64_t begin, uint64_t count, Equity& equity) {
+        const unsigned k = 7 - playerHands[0].size();
+        std::vector<CardValue_52_t> combination;
+        combination.reserve(7);
+        std::vector<unsigned> winners;
+
+        for (auto sample = begin; sample < begin + count; ++sample) {
+            combination.resize(k);
+            m_sampler.runout(sample, cards, cards.size(), k, combination);
+            comparePlayerHandsForCombination(playerHands, combination, winners);
+            tally(winners, equity);
+            equity.boards += 1;
+        }
+    }
+
     std::vector<CardValue_52_t> getAvailableCards(const std::vector<std::vector<CardValue_52_t>>& players) {
+        ALLOC_SCOPE("Predictor::getAvailableCards");
         std::vector<bool> deck(52, true);
+        if (Variant::cards != 52)
+            for (auto c = 0; c < 52; ++c)
+                deck[c] = Variant::contains(c);
         for (auto& player : players)
             for (auto card : player)
                 deck[card] = false;
@@ -92,10 +743,135 @@ private:
         return cards;
     }
 
-    int comparePlayerHandsForCombination(const std::vector<std::vector<CardValue_52_t>>& players, 
-                                          std::vector<CardValue_52_t>& combination) {
+    // Run shares split potUnits evenly and winners fit a 32 bit mask only up to maxPlayers.
+    static void checkRunPlayers(const std::vector<std::vector<CardValue_52_t>>& playerHands) {
+        if (playerHands.empty() || playerHands.size() > MultiBoardEquity::maxPlayers)
+            throw std::invalid_argument("running it more than once needs 1 to " + std::to_string(MultiBoardEquity::maxPlayers) + " players");
+    }
+
+    static MultiBoardEquity emptyRuns(const std::vector<std::vector<CardValue_52_t>>& playerHands, unsigned runs, uint64_t begin) {
+        MultiBoardEquity equity;
+        equity.runs = runs;
+        equity.begin = begin;
+        equity.boardShares.assign(runs, std::vector<uint64_t>(playerHands.size(), 0));
+        equity.shares.resize(playerHands.size(), 0);
+        equity.scoops.resize(playerHands.size(), 0);
+        return equity;
+    }
+
+    static std::vector<typename Evaluator::Deck_t> holeMasks(const std::vector<std::vector<CardValue_52_t>>& playerHands) {
+        std::vector<typename Evaluator::Deck_t> holes(playerHands.size(), 0);
+        for (auto p = 0u; p < playerHands.size(); ++p)
+            for (auto card : playerHands[p])
+                holes[p] |= typename Evaluator::Deck_t{1} << card;
+        return holes;
+    }
+
+    // Board of run r from its indices into stubs[r], and the stub left for run r + 1.
+    static void dealRun(std::vector<std::vector<CardValue_52_t>>& stubs, const std::vector<std::vector<unsigned>>& indices,
+                        std::vector<typename Evaluator::Deck_t>& boards, unsigned r) {
+        auto& stub = stubs[r];
+        auto& left = stubs[r + 1];
+        boards[r] = 0;
+        left.clear();
+        auto chosen = indices[r].begin();
+        for (auto i = 0u; i < stub.size(); ++i) {
+            if (chosen != indices[r].end() && *chosen == i) {
+                boards[r] |= typename Evaluator::Deck_t{1} << stub[i];
+                ++chosen;
+            } else {
+                left.push_back(stub[i]);
+            }
+        }
+    }
+
+    static void settleRuns(const std::vector<typename Evaluator::Deck_t>& holes, const std::vector<typename Evaluator::Deck_t>& boards,
+                           MultiBoardEquity& equity) {
+        uint32_t scooped = (1u << holes.size()) - 1;
+        for (auto r = 0u; r < boards.size(); ++r) {
+            typename Evaluator::Value_t best = 0;
+            uint32_t winners = 0;
+            for (auto p = 0u; p < holes.size(); ++p) {
+                const auto value = Evaluator::evaluate(holes[p] | boards[r]);
+                if (p == 0 || value > best) {
+                    best = value;
+                    winners = 1u << p;
+                } else if (value == best) {
+                    winners |= 1u << p;
+                }
+            }
+
+            const auto share = MultiBoardEquity::potUnits / __builtin_popcount(winners);
+            for (auto p = 0u; p < holes.size(); ++p) {
+                if (winners & (1u << p)) {
+                    equity.boardShares[r][p] += share;
+                    equity.shares[p] += share;
+                }
+            }
+            if (__builtin_popcount(winners) > 1)
+                scooped = 0;
+            scooped &= winners;
+        }
+        for (auto p = 0u; p < holes.size(); ++p)
+            equity.scoops[p] += (scooped >> p) & 1;
+    }
+
+    static void settleHiLo(const std::vector<typename Evaluator::Deck_t>& holes, typename Evaluator::Deck_t board, HiLoEquity& equity) {
+        typename Evaluator::Value_t bestHigh = 0;
+        typename Evaluator::Low_t bestLow = 0;
+        uint32_t highWinners = 0;
+        uint32_t lowWinners = 0;
+
+        for (auto p = 0u; p < holes.size(); ++p) {
+            const auto deck = holes[p] | board;
+            const auto high = Evaluator::evaluate(deck);
+            const auto low = Evaluator::evaluateLow(deck);
+            if (p == 0 || high > bestHigh) {
+                bestHigh = high;
+                highWinners = 1u << p;
+            } else if (high == bestHigh) {
+                highWinners |= 1u << p;
+            }
+            if (low > bestLow) {
+                bestLow = low;
+                lowWinners = 1u << p;
+            } else if (low && low == bestLow) {
+                lowWinners |= 1u << p;
+            }
+        }
+
+        const auto half = HiLoEquity::potUnits / 2;
+        const auto highShare = (lowWinners ? half : HiLoEquity::potUnits) / __builtin_popcount(highWinners);
+        const auto lowShare = lowWinners ? half / __builtin_popcount(lowWinners) : 0;
+        equity.lowBoards += lowWinners != 0;
+        for (auto p = 0u; p < holes.size(); ++p) {
+            uint64_t won = 0;
+            if (highWinners & (1u << p)) {
+                equity.highWins[p] += 1;
+                won += highShare;
+            }
+            if (lowWinners & (1u << p)) {
+                equity.lowWins[p] += 1;
+                won += lowShare;
+            }
+            equity.shares[p] += won;
+            equity.scoops[p] += won == HiLoEquity::potUnits;
+        }
+    }
+
+    static void tally(const std::vector<unsigned>& winners, Equity& equity) {
+        if (winners.size() == 1)
+            equity.wins[winners[0]] += 1;
+        else
+            for (auto p : winners)
+                equity.ties[p] += 1;
+    }
+
+    void comparePlayerHandsForCombination(const std::vector<std::vector<CardValue_52_t>>& players, 
+                                          std::vector<CardValue_52_t>& combination, std::vector<unsigned>& winners) {
+        ALLOC_SCOPE("Predictor::comparePlayerHandsForCombination");
         std::unique_ptr<Hand> winningHand = std::make_unique<HighCard>(std::vector<CardValue_13_t>{5, 3, 2, 1, 0});
-        std::vector<unsigned> winners;
+        winners.clear();
 
         for (auto p = 0; p < players.size(); ++p) {
             auto& player = players[p];
@@ -108,7 +884,7 @@ private:
             for (auto c = 0; c < player.size(); ++c)
                 combination.pop_back();
             
-            if (*winningHand < *hand) {
+            if (Variant::less(*winningHand, *hand)) {
                 winningHand = std::move(hand);
                 winners.clear();
                 winners.push_back(p);
@@ -116,12 +892,14 @@ private:
                 winners.push_back(p);
             }
         }
-
-        if (winners.size() == 1)
-            return winners[0];
-        return -1;
     }
 
     IAnalyzer&  m_analyzer;
+    const PreflopTable* m_preflopTable = nullptr;
+    double m_nsPerHand = 0.;
+    RunoutSampler m_sampler;
 };
 
+using Predictor = BasicPredictor<StandardDeck>;
+using ShortDeckPredictor = BasicPredictor<ShortDeck>;
+
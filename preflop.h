@@ -0,0 +1,209 @@
+#pragma once
+
+#include "card.h"
+#include "fastanalyzer.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Exact heads-up preflop results for every suit isomorphic matchup, read from a
+// memory mapped file. The file is a Header followed by Entries sorted by key:
+// each entry holds the outcome of all 1712304 boards for the first hand of the key.
+class PreflopTable {
+public:
+    static constexpr uint32_t fileMagic = 0x51454650; // "PFEQ"
+    static constexpr uint32_t fileVersion = 1;
+    static constexpr uint32_t boardsPerMatchup = 1712304;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entries;
+        uint32_t boards;
+    };
+
+    struct Entry {
+        uint32_t key;
+        uint32_t wins;
+        uint32_t ties;
+    };
+
+    struct Matchup {
+        uint32_t wins = 0;
+        uint32_t ties = 0;
+        uint32_t losses = 0;
+    };
+
+    PreflopTable() = default;
+
+    explicit PreflopTable(const std::string& path) : m_file{path} {
+        if (m_file.size() < sizeof(Header))
+            throw std::runtime_error("preflop table too small: " + path);
+        std::memcpy(&m_header, m_file.data(), sizeof(Header));
+        if (m_header.magic != fileMagic || m_header.version != fileVersion || m_header.boards != boardsPerMatchup)
+            throw std::runtime_error("not a preflop table: " + path);
+        if (m_file.size() != sizeof(Header) + size_t{m_header.entries} * sizeof(Entry))
+            throw std::runtime_error("truncated preflop table: " + path);
+        m_entries = reinterpret_cast<const Entry*>(m_file.data() + sizeof(Header));
+    }
+
+    bool loaded() const { return m_entries != nullptr; }
+    uint32_t size() const { return m_header.entries; }
+
+    bool lookup(const std::array<CardValue_52_t, 2>& hero, const std::array<CardValue_52_t, 2>& villain,
+                Matchup& matchup) const {
+        if (!loaded())
+            return false;
+
+        bool swapped = false;
+        auto key = canonicalKey(hero, villain, swapped);
+        auto end = m_entries + m_header.entries;
+        auto it = std::lower_bound(m_entries, end, key, [](const Entry& e, uint32_t k) { return e.key < k; });
+        if (it == end || it->key != key)
+            return false;
+
+        matchup.ties = it->ties;
+        matchup.wins = swapped ? boardsPerMatchup - it->wins - it->ties : it->wins;
+        matchup.losses = boardsPerMatchup - matchup.wins - matchup.ties;
+        return true;
+    }
+
+    // Smallest packing of the two hands over all 24 suit relabelings and both seat orders.
+    // Four six bit cards, hero high and low card first; swapped tells whether the villain
+    // ended up in the hero seat.
+    static uint32_t canonicalKey(const std::array<CardValue_52_t, 2>& hero, const std::array<CardValue_52_t, 2>& villain,
+                                 bool& swapped) {
+        std::array<CardSuit_t, 4> permutation{0, 1, 2, 3};
+        uint32_t best = ~0u;
+        do {
+            auto relabel = [&](CardValue_52_t c) {
+                return CardValue_52_t(permutation[Card::suit(c)] * 13 + Card::value(c));
+            };
+            auto h = pack(relabel(hero[0]), relabel(hero[1]));
+            auto v = pack(relabel(villain[0]), relabel(villain[1]));
+            if ((h << 12 | v) < best) {
+                best = h << 12 | v;
+                swapped = false;
+            }
+            if ((v << 12 | h) < best) {
+                best = v << 12 | h;
+                swapped = true;
+            }
+        } while (std::next_permutation(permutation.begin(), permutation.end()));
+        return best;
+    }
+
+    static void decodeKey(uint32_t key, std::array<CardValue_52_t, 2>& hero, std::array<CardValue_52_t, 2>& villain) {
+        hero = {CardValue_52_t(key >> 18 & 0x3f), CardValue_52_t(key >> 12 & 0x3f)};
+        villain = {CardValue_52_t(key >> 6 & 0x3f), CardValue_52_t(key & 0x3f)};
+    }
+
+private:
+    static uint32_t pack(CardValue_52_t a, CardValue_52_t b) {
+        return a > b ? uint32_t(a) << 6 | b : uint32_t(b) << 6 | a;
+    }
+
+    MappedFile m_file;
+    Header m_header{};
+    const Entry* m_entries = nullptr;
+};
+
+// Offline builder of the preflop table: finds one representative per isomorphism
+// class and enumerates its boards exactly with FastAnalyzer::evaluate.
+class PreflopTableGenerator {
+public:
+    static std::vector<uint32_t> canonicalKeys() {
+        std::vector<uint32_t> keys;
+        for (auto a = 0; a < 52; ++a)
+            for (auto b = a + 1; b < 52; ++b)
+                for (auto c = 0; c < 52; ++c)
+                    for (auto d = c + 1; d < 52; ++d) {
+                        if (c == a || c == b || d == a || d == b)
+                            continue;
+                        bool swapped = false;
+                        keys.push_back(PreflopTable::canonicalKey({CardValue_52_t(a), CardValue_52_t(b)},
+                                                                  {CardValue_52_t(c), CardValue_52_t(d)}, swapped));
+                    }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    // Walks all five card boards of the remaining 48 cards, building board masks incrementally.
+    static PreflopTable::Entry headsUp(FastAnalyzer::Deck_t hero, FastAnalyzer::Deck_t villain) {
+        std::array<FastAnalyzer::Deck_t, 52> cards{};
+        auto n = 0;
+        for (auto c = 0; c < 52; ++c)
+            if (!((hero | villain) & (FastAnalyzer::Deck_t{1} << c)))
+                cards[n++] = FastAnalyzer::Deck_t{1} << c;
+
+        PreflopTable::Entry entry{};
+        for (auto i0 = 0; i0 < n; ++i0) {
+            auto b0 = cards[i0];
+            for (auto i1 = i0 + 1; i1 < n; ++i1) {
+                auto b1 = b0 | cards[i1];
+                for (auto i2 = i1 + 1; i2 < n; ++i2) {
+                    auto b2 = b1 | cards[i2];
+                    for (auto i3 = i2 + 1; i3 < n; ++i3) {
+                        auto b3 = b2 | cards[i3];
+                        for (auto i4 = i3 + 1; i4 < n; ++i4) {
+                            auto board = b3 | cards[i4];
+                            auto h = FastAnalyzer::evaluate(hero | board);
+                            auto v = FastAnalyzer::evaluate(villain | board);
+                            entry.wins += h > v;
+                            entry.ties += h == v;
+                        }
+                    }
+                }
+            }
+        }
+        return entry;
+    }
+
+    static void generate(const std::string& path, unsigned threads) {
+        generate(path, threads, canonicalKeys());
+    }
+
+    // Writes a table of just the given canonical keys, which must be sorted.
+    static void generate(const std::string& path, unsigned threads, const std::vector<uint32_t>& keys) {
+        std::vector<PreflopTable::Entry> entries(keys.size());
+        std::atomic<size_t> next{0};
+
+        auto worker = [&]() {
+            for (auto i = next++; i < keys.size(); i = next++) {
+                std::array<CardValue_52_t, 2> hero, villain;
+                PreflopTable::decodeKey(keys[i], hero, villain);
+                entries[i] = headsUp(toDeck(hero), toDeck(villain));
+                entries[i].key = keys[i];
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (auto t = 0u; t < std::max(threads, 1u); ++t)
+            pool.emplace_back(worker);
+        for (auto& thread : pool)
+            thread.join();
+
+        PreflopTable::Header header{PreflopTable::fileMagic, PreflopTable::fileVersion,
+                                    uint32_t(entries.size()), PreflopTable::boardsPerMatchup};
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PreflopTable::Entry));
+        if (!out)
+            throw std::runtime_error("cannot write preflop table " + path);
+    }
+
+private:
+    static FastAnalyzer::Deck_t toDeck(const std::array<CardValue_52_t, 2>& hand) {
+        return (FastAnalyzer::Deck_t{1} << hand[0]) | (FastAnalyzer::Deck_t{1} << hand[1]);
+    }
+};
@@ -0,0 +1,30 @@
+#include "preflop.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// preflopgen <path> [threads]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: preflopgen <path> [threads]\n";
+        return 1;
+    }
+
+    unsigned threads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+    auto tstart = std::chrono::high_resolution_clock::now();
+
+    try {
+        PreflopTableGenerator::generate(argv[1], threads);
+        PreflopTable table{argv[1]};
+        auto tend = std::chrono::high_resolution_clock::now();
+        std::cout << table.size() << " matchups written to " << argv[1] << " in "
+                  << std::chrono::duration_cast<std::chrono::seconds>(tend - tstart).count() << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "fastanalyzer.h"
+#include "preflop.h"
+#include "replay.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// replay pack <spots.txt> <corpus>    convert one Spot notation line per spot into a corpus
+// replay run [options] <corpus>       replay a corpus and report latency percentiles
+//   --concurrency <n>   worker threads, default all cores
+//   --rate <spots/s>    Poisson arrivals at that rate, default as fast as the workers go
+//   --budget-ms <ms>    predictWithin budget per spot, default exact enumeration
+//   --preflop <table>   answer heads-up preflop spots from a preflop table
+//   --limit <n>         replay only the first n spots
+void usage() {
+    std::cerr << "usage: replay pack <spots.txt> <corpus>\n"
+              << "       replay run [--concurrency n] [--rate spots/s] [--budget-ms ms] [--preflop table] [--limit n] <corpus>\n";
+}
+
+void printLatencies(const std::string& name, const std::vector<double>& sorted) {
+    std::cout << std::left << std::setw(18) << name << std::right << std::setw(8) << sorted.size();
+    for (auto q : {0.5, 0.99, 0.999})
+        std::cout << std::setw(12) << std::fixed << std::setprecision(3) << ReplayReport::percentile(sorted, q) / 1e6;
+    std::cout << std::setw(12) << (sorted.empty() ? 0. : sorted.back() / 1e6) << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+
+    const std::string command = argv[1];
+
+    try {
+        if (command == "pack" && argc == 4) {
+            std::ifstream in(argv[2]);
+            if (!in)
+                throw std::runtime_error(std::string{"cannot open "} + argv[2]);
+            auto spots = SpotCorpus::parseText(in);
+            SpotCorpus::store(argv[3], spots);
+            std::cout << spots.size() << " spots written to " << argv[3] << std::endl;
+            return 0;
+        }
+        if (command != "run") {
+            usage();
+            return 1;
+        }
+
+        ReplayDriver::Options options;
+        options.concurrency = std::thread::hardware_concurrency();
+        std::string preflopPath;
+        uint64_t limit = ~uint64_t{0};
+        std::string corpus;
+        for (auto i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--concurrency")
+                options.concurrency = std::stoul(value());
+            else if (arg == "--rate")
+                options.rate = std::stod(value());
+            else if (arg == "--budget-ms")
+                options.budget = std::chrono::microseconds(static_cast<int64_t>(std::stod(value()) * 1000));
+            else if (arg == "--preflop")
+                preflopPath = value();
+            else if (arg == "--limit")
+                limit = std::stoull(value());
+            else
+                corpus = arg;
+        }
+        if (corpus.empty()) {
+            usage();
+            return 1;
+        }
+
+        auto spots = SpotCorpus::load(corpus);
+        if (spots.size() > limit)
+            spots.resize(limit);
+
+        std::unique_ptr<PreflopTable> table;
+        if (!preflopPath.empty())
+            table = std::make_unique<PreflopTable>(preflopPath);
+
+        FastAnalyzer fast{};
+        ReplayDriver driver{fast, table.get()};
+        auto report = driver.run(spots, options);
+
+        std::cout << report.spots << " spots in " << std::fixed << std::setprecision(2) << report.seconds << " s, "
+                  << report.throughput() << " spots/s, concurrency " << options.concurrency << std::endl;
+        std::cout << std::left << std::setw(18) << "latency ms" << std::right << std::setw(8) << "spots"
+                  << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "p99.9" << std::setw(12) << "max" << std::endl;
+        printLatencies("all", report.latencies);
+        for (const auto& entry : report.byKind)
+            printLatencies(entry.first, entry.second);
+        if (report.failures > 0) {
+            std::cerr << report.failures << " spots failed to evaluate" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
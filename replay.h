@@ -0,0 +1,274 @@
+#pragma once
+
+#include "analyzer.h"
+#include "card.h"
+#include "mappedfile.h"
+#include "predictor.h"
+#include "preflop.h"
+#include "rng.h"
+#include "shard.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Recorded spots in a compact binary file: a Header followed by one record per spot,
+// in arrival order. A record is a player count byte, a board size byte, the board cards
+// and then two hole cards per player, one byte per card.
+class SpotCorpus {
+public:
+    using Players = std::vector<std::vector<CardValue_52_t>>;
+
+    static constexpr uint32_t fileMagic = 0x544f5053; // "SPOT"
+    static constexpr uint32_t fileVersion = 1;
+    static constexpr unsigned maxPlayers = 10;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t spots;
+        uint32_t reserved;
+    };
+
+    static std::string encode(const std::vector<Players>& spots) {
+        Header header{fileMagic, fileVersion, uint32_t(spots.size()), 0};
+        std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& players : spots) {
+            if (players.size() < 2 || players.size() > maxPlayers)
+                throw std::invalid_argument("spot needs 2 to 10 players: " + Spot::toString(players));
+            const auto boardSize = players[0].size() - 2;
+            if (players[0].size() < 2 || !validBoardSize(boardSize))
+                throw std::invalid_argument("spot needs two hole cards and a preflop, flop, turn or river board: " + Spot::toString(players));
+            for (const auto& hand : players) {
+                if (hand.size() != players[0].size() || !std::equal(hand.begin() + 2, hand.end(), players[0].begin() + 2))
+                    throw std::invalid_argument("players of a spot must share the board: " + Spot::toString(players));
+            }
+
+            data += char(players.size());
+            data += char(boardSize);
+            data.append(players[0].begin() + 2, players[0].end());
+            for (const auto& hand : players)
+                data.append(hand.begin(), hand.begin() + 2);
+        }
+        return data;
+    }
+
+    // Spots in Predictor form: every player's hole cards followed by the board.
+    static std::vector<Players> decode(const char* data, size_t size) {
+        Header header{};
+        if (size < sizeof(header))
+            throw std::runtime_error("spot corpus too small");
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != fileMagic || header.version != fileVersion)
+            throw std::runtime_error("not a spot corpus");
+
+        std::vector<Players> spots;
+        spots.reserve(header.spots);
+        size_t pos = sizeof(header);
+        for (auto s = 0u; s < header.spots; ++s) {
+            if (pos + 2 > size)
+                throw std::runtime_error("truncated spot corpus");
+            const unsigned players = uint8_t(data[pos]);
+            const unsigned boardSize = uint8_t(data[pos + 1]);
+            if (players < 2 || players > maxPlayers || !validBoardSize(boardSize) || pos + 2 + boardSize + 2 * players > size)
+                throw std::runtime_error("malformed spot corpus record " + std::to_string(s));
+            const auto board = data + pos + 2;
+            const auto holes = board + boardSize;
+            uint64_t seen = 0;
+            for (auto c = 0u; c < boardSize + 2 * players; ++c) {
+                const unsigned card = uint8_t(board[c]);
+                if (card >= 52 || (seen >> card & 1))
+                    throw std::runtime_error("malformed spot corpus record " + std::to_string(s));
+                seen |= uint64_t{1} << card;
+            }
+
+            Players spot(players);
+            for (auto p = 0u; p < players; ++p) {
+                spot[p] = {CardValue_52_t(holes[2 * p]), CardValue_52_t(holes[2 * p + 1])};
+                spot[p].insert(spot[p].end(), board, board + boardSize);
+            }
+            spots.push_back(std::move(spot));
+            pos += 2 + boardSize + 2 * players;
+        }
+        return spots;
+    }
+
+    // No board, or a flop, turn or river; one or two board cards is no street.
+    static bool validBoardSize(size_t size) { return size == 0 || (size >= 3 && size <= 5); }
+
+    static std::vector<Players> load(const std::string& path) {
+        MappedFile file{path};
+        file.sequential();
+        return decode(file.data(), file.size());
+    }
+
+    static void store(const std::string& path, const std::vector<Players>& spots) {
+        auto data = encode(spots);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        if (!out)
+            throw std::runtime_error("cannot write spot corpus " + path);
+    }
+
+    // One spot per line in Spot notation; blank lines and lines starting with # are skipped.
+    static std::vector<Players> parseText(std::istream& in) {
+        std::vector<Players> spots;
+        std::string line;
+        while (std::getline(in, line)) {
+            line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return std::isspace(uint8_t(c)); }), line.end());
+            if (line.empty() || line[0] == '#')
+                continue;
+            spots.push_back(Spot::fromString(line));
+        }
+        return spots;
+    }
+};
+
+// Latencies of a replay, in nanoseconds, overall and per kind of spot. Spots whose
+// evaluation threw are counted in failures and have no latency.
+struct ReplayReport {
+    uint64_t spots = 0;
+    uint64_t failures = 0;
+    double seconds = 0.;
+    std::vector<double> latencies;
+    std::map<std::string, std::vector<double>> byKind;
+
+    double throughput() const { return seconds > 0. ? spots / seconds : 0.; }
+
+    // Nearest rank percentile of sorted latencies, q in [0, 1].
+    static double percentile(const std::vector<double>& sorted, double q) {
+        if (sorted.empty())
+            return 0.;
+        auto rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+        return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+};
+
+// Replays a corpus through Predictor on a pool of the given concurrency. With a rate,
+// spots arrive as a Poisson process of that many spots per second and latency runs from
+// the scheduled arrival to completion, so queueing behind slow spots is counted. Without
+// one, the pool is kept saturated and latency is the time spent evaluating.
+// A zero budget enumerates every spot exactly, otherwise predictWithin gets that budget.
+class ReplayDriver {
+public:
+    struct Options {
+        unsigned concurrency = 1;
+        double rate = 0.;
+        std::chrono::nanoseconds budget{0};
+        uint64_t seed = 1;
+    };
+
+    explicit ReplayDriver(IAnalyzer& analyzer, const PreflopTable* preflopTable = nullptr)
+        : m_analyzer{analyzer}, m_preflopTable{preflopTable} {}
+
+    static std::string kind(const SpotCorpus::Players& players) {
+        const char* streets[] = {"preflop", "", "", "flop", "turn", "river"};
+        return std::string{streets[std::min<size_t>(players[0].size() - 2, 5)]} + (players.size() == 2 ? " heads-up" : " multiway");
+    }
+
+    ReplayReport run(const std::vector<SpotCorpus::Players>& spots, const Options& options) {
+        using Clock = std::chrono::steady_clock;
+
+        ReplayReport report;
+        report.spots = spots.size();
+        report.latencies.resize(spots.size());
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t remaining = spots.size();
+
+        // One Predictor per worker, reused across spots so predictWithin keeps its
+        // learned cost per hand instead of calibrating on every spot.
+        std::vector<std::unique_ptr<Predictor>> idle;
+        std::vector<char> failed(spots.size(), 0);
+        idle.reserve(std::max(options.concurrency, 1u));
+        for (auto w = 0u; w < std::max(options.concurrency, 1u); ++w) {
+            idle.push_back(std::make_unique<Predictor>(m_analyzer));
+            if (m_preflopTable)
+                idle.back()->usePreflopTable(*m_preflopTable);
+        }
+
+        ThreadPool pool{options.concurrency};
+        SampleStream arrivals{options.seed, 0};
+        const auto tstart = Clock::now();
+        auto arrival = tstart;
+
+        for (size_t s = 0; s < spots.size(); ++s) {
+            if (options.rate > 0.) {
+                const double u = (arrivals.next() + 0.5) / 4294967296.;
+                arrival += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-std::log(u) / options.rate));
+                std::this_thread::sleep_until(arrival);
+            }
+
+            pool.submit([&, s, arrival] {
+                std::unique_ptr<Predictor> predictor;
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    predictor = std::move(idle.back());
+                    idle.pop_back();
+                }
+
+                // A throw must not reach the pool, which would terminate, nor skip
+                // returning the predictor and counting the spot, which would hang run().
+                const auto tbegin = Clock::now();
+                try {
+                    evaluate(*predictor, spots[s], options.budget);
+                } catch (...) {
+                    failed[s] = 1;
+                }
+                const auto tend = Clock::now();
+                const auto from = options.rate > 0. ? arrival : tbegin;
+                report.latencies[s] = std::chrono::duration<double, std::nano>(tend - from).count();
+
+                std::lock_guard<std::mutex> lock{mutex};
+                idle.push_back(std::move(predictor));
+                if (--remaining == 0)
+                    finished.notify_one();
+            });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            finished.wait(lock, [&] { return remaining == 0; });
+        }
+        report.seconds = std::chrono::duration<double>(Clock::now() - tstart).count();
+
+        std::vector<double> latencies;
+        for (size_t s = 0; s < spots.size(); ++s) {
+            if (failed[s]) {
+                ++report.failures;
+                continue;
+            }
+            latencies.push_back(report.latencies[s]);
+            report.byKind[kind(spots[s])].push_back(report.latencies[s]);
+        }
+        report.latencies = std::move(latencies);
+        std::sort(report.latencies.begin(), report.latencies.end());
+        for (auto& entry : report.byKind)
+            std::sort(entry.second.begin(), entry.second.end());
+        return report;
+    }
+
+private:
+    static void evaluate(Predictor& predictor, const SpotCorpus::Players& players, std::chrono::nanoseconds budget) {
+        if (budget.count() > 0)
+            predictor.predictWithin(players, budget);
+        else
+            predictor.predictRange(players, 0, predictor.numberOfBoards(players));
+    }
+
+    IAnalyzer& m_analyzer;
+    const PreflopTable* m_preflopTable;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "card.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+// Philox4x32-10 counter based generator: a keyed bijection of a 128 bit counter,
+// so block i of a stream is computed directly instead of by stepping a state.
+class Philox {
+public:
+    using Block = std::array<uint32_t, 4>;
+
+    static Block generate(uint64_t key, uint64_t counterLow, uint64_t counterHigh) {
+        Block ctr{uint32_t(counterLow), uint32_t(counterLow >> 32), uint32_t(counterHigh), uint32_t(counterHigh >> 32)};
+        uint32_t k0 = uint32_t(key);
+        uint32_t k1 = uint32_t(key >> 32);
+
+        for (auto round = 0; round < 10; ++round) {
+            uint64_t p0 = uint64_t{multiplier0} * ctr[0];
+            uint64_t p1 = uint64_t{multiplier1} * ctr[2];
+            ctr = {uint32_t(p1 >> 32) ^ ctr[1] ^ k0, uint32_t(p1),
+                   uint32_t(p0 >> 32) ^ ctr[3] ^ k1, uint32_t(p0)};
+            k0 += weyl0;
+            k1 += weyl1;
+        }
+        return ctr;
+    }
+
+private:
+    static constexpr uint32_t multiplier0 = 0xD2511F53;
+    static constexpr uint32_t multiplier1 = 0xCD9E8D57;
+    static constexpr uint32_t weyl0 = 0x9E3779B9;
+    static constexpr uint32_t weyl1 = 0xBB67AE85;
+};
+
+// Random numbers of one sample: sample i of a seed is the Philox stream with counter
+// (i, 0), (i, 1), ... so any thread or process reproduces it from (seed, i) alone.
+class SampleStream {
+public:
+    SampleStream(uint64_t seed, uint64_t sample) : m_seed{seed}, m_sample{sample} {}
+
+    uint32_t next() {
+        if (m_used == 4) {
+            m_block = Philox::generate(m_seed, m_sample, m_blocks++);
+            m_used = 0;
+        }
+        return m_block[m_used++];
+    }
+
+    // Uniform in [0, range) by multiply and shift; the bias is below range / 2^32.
+    uint32_t below(uint32_t range) {
+        return uint32_t((uint64_t{next()} * range) >> 32);
+    }
+
+private:
+    uint64_t m_seed;
+    uint64_t m_sample;
+    uint64_t m_blocks = 0;
+    Philox::Block m_block{};
+    unsigned m_used = 4;
+};
+
+// Draws the k card runout of sample i from the given cards, independent of any other sample.
+class RunoutSampler {
+public:
+    // Seeded from std::random_device; pass a seed to reproduce samples.
+    RunoutSampler() : m_seed{(uint64_t{std::random_device{}()} << 32) | std::random_device{}()} {}
+    explicit RunoutSampler(uint64_t seed) : m_seed{seed} {}
+
+    uint64_t seed() const { return m_seed; }
+
+    // Writes k distinct cards of cards[0, n) into runout, redrawing on repeats.
+    template<typename Cards, typename Out>
+    void runout(uint64_t sample, const Cards& cards, unsigned n, unsigned k, Out& runout) const {
+        SampleStream stream{m_seed, sample};
+        uint64_t chosen = 0;
+        for (auto i = 0u; i < k;) {
+            auto j = stream.below(n);
+            if (chosen & (uint64_t{1} << j))
+                continue;
+            chosen |= uint64_t{1} << j;
+            runout[i++] = cards[j];
+        }
+    }
+
+private:
+    uint64_t m_seed;
+};
@@ -0,0 +1,60 @@
+#include "fastanalyzer.h"
+#include "predictor.h"
+#include "shard.h"
+
+#include <iostream>
+#include <string>
+
+// shard range <spot> <begin> <count>                evaluate one board range, print its shard line
+// shard fork <spot> <workers> <chunk> <directory>   run the whole spot in forked workers, resumable
+// shard merge <file>...                             merge shard files from any number of nodes
+void usage() {
+    std::cerr << "usage: shard range <spot> <begin> <count>\n"
+              << "       shard fork <spot> <workers> <chunk> <directory>\n"
+              << "       shard merge <file>...\n";
+}
+
+void report(const ShardResult& result) {
+    std::cout << result.serialize() << std::endl;
+    for (auto p = 0u; p < result.equity.wins.size(); ++p) {
+        std::cout << "player " << p << ": " << 100. * result.equity.wins[p] / result.equity.boards << "% win, "
+                  << 100. * result.equity.ties[p] / result.equity.boards << "% tie" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    const std::string command = argv[1];
+    FastAnalyzer fast{};
+
+    try {
+        if (command == "range" && argc == 5) {
+            Predictor predictor{fast};
+            auto players = Spot::fromString(argv[2]);
+            ShardResult result;
+            result.spot = Spot::toString(players);
+            result.equity = predictor.predictRange(players, std::stoull(argv[3]), std::stoull(argv[4]));
+            std::cout << result.serialize() << std::endl;
+        } else if (command == "fork" && argc == 6) {
+            ShardDriver driver{fast, static_cast<unsigned>(std::stoul(argv[3])), std::stoull(argv[4])};
+            report(driver.run(Spot::fromString(argv[2]), argv[5]));
+        } else if (command == "merge" && argc > 2) {
+            ShardResult merged;
+            for (auto i = 2; i < argc; ++i)
+                merged.merge(ShardResult::load(argv[i]));
+            report(merged);
+        } else {
+            usage();
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
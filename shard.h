@@ -0,0 +1,222 @@
+#pragma once
+
+#include "card.h"
+#include "predictor.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A spot is written as comma separated players, each a run of two character cards:
+// "AsAd,7c8c" or, with a flop dealt to both players, "AsAdKh7d2c,7c8cKh7d2c".
+class Spot {
+public:
+    static std::vector<std::vector<CardValue_52_t>> fromString(const std::string& str) {
+        std::vector<std::vector<CardValue_52_t>> players(1);
+        for (size_t i = 0; i < str.size();) {
+            if (str[i] == ',') {
+                players.emplace_back();
+                ++i;
+                continue;
+            }
+            if (i + 1 >= str.size())
+                throw std::invalid_argument("truncated card in spot " + str);
+            auto card = Card::fromChars(str[i], str[i + 1]);
+            if (card == Card::invalid)
+                throw std::invalid_argument("bad card in spot " + str);
+            players.back().push_back(card);
+            i += 2;
+        }
+        return players;
+    }
+
+    static std::string toString(const std::vector<std::vector<CardValue_52_t>>& players) {
+        std::string str;
+        for (auto p = 0u; p < players.size(); ++p) {
+            if (p > 0)
+                str += ',';
+            for (auto card : players[p])
+                str += Card::toString(card);
+        }
+        return str;
+    }
+};
+
+// Equity over a board range of one spot, in a single line text form:
+//   shard <spot> <begin> <boards> <players> <wins0> <ties0> <wins1> <ties1> ...
+// Shards of the same spot merge exactly no matter which process or node produced them.
+class ShardResult {
+public:
+    std::string spot;
+    Equity equity;
+
+    std::string serialize() const {
+        std::ostringstream out;
+        out << "shard " << spot << ' ' << equity.begin << ' ' << equity.boards << ' ' << equity.wins.size();
+        for (auto p = 0u; p < equity.wins.size(); ++p)
+            out << ' ' << equity.wins[p] << ' ' << equity.ties[p];
+        return out.str();
+    }
+
+    static ShardResult parse(const std::string& line) {
+        std::istringstream in(line);
+        std::string tag;
+        ShardResult result;
+        size_t players = 0;
+        in >> tag >> result.spot >> result.equity.begin >> result.equity.boards >> players;
+        if (!in || tag != "shard")
+            throw std::runtime_error("malformed shard: " + line);
+        result.equity.wins.resize(players);
+        result.equity.ties.resize(players);
+        for (auto p = 0u; p < players; ++p)
+            in >> result.equity.wins[p] >> result.equity.ties[p];
+        if (!in)
+            throw std::runtime_error("malformed shard: " + line);
+        return result;
+    }
+
+    static ShardResult load(const std::string& path) {
+        std::ifstream in(path);
+        std::string line;
+        if (!std::getline(in, line))
+            throw std::runtime_error("cannot read shard " + path);
+        return parse(line);
+    }
+
+    // Written to a temporary name and renamed, so a shard file either exists complete or not at all.
+    void store(const std::string& path) const {
+        auto tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << serialize() << '\n';
+            if (!out)
+                throw std::runtime_error("cannot write shard " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("cannot rename shard " + tmp);
+    }
+
+    // Merging requires the same spot and non-overlapping board ranges; Equity::merge
+    // throws on overlap, so the same shard given twice is an error.
+    void merge(const ShardResult& other) {
+        if (equity.boards > 0 && spot != other.spot)
+            throw std::runtime_error("cannot merge shards of " + spot + " and " + other.spot);
+        spot = other.spot;
+        equity.merge(other.equity);
+    }
+};
+
+// Splits a spot into fixed size chunks and works through them in forked worker
+// processes. Each finished chunk is checkpointed to <directory>/<chunk>.shard,
+// so rerunning an interrupted job only computes the missing chunks. The directory's
+// manifest names the spot and chunk size its shards belong to; a rerun with another
+// spot or chunk size is refused, and every reused shard is checked against its chunk.
+class ShardDriver {
+public:
+    ShardDriver(IAnalyzer& analyzer, unsigned workers, uint64_t chunkSize)
+        : m_predictor{analyzer}, m_workers{std::max(workers, 1u)}, m_chunkSize{std::max<uint64_t>(chunkSize, 1)}
+    {}
+
+    ShardResult run(const std::vector<std::vector<CardValue_52_t>>& players, const std::string& directory) {
+        if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("cannot create shard directory " + directory + ": " + std::strerror(errno));
+
+        const auto boards = m_predictor.numberOfBoards(players);
+        const auto chunks = (boards + m_chunkSize - 1) / m_chunkSize;
+        claim(directory, players);
+
+        std::vector<pid_t> children;
+        for (auto w = 0u; w < m_workers; ++w) {
+            auto pid = ::fork();
+            if (pid < 0)
+                throw std::runtime_error("fork failed");
+            if (pid == 0) {
+                try {
+                    work(players, directory, w, chunks);
+                } catch (...) {
+                    ::_exit(1);
+                }
+                ::_exit(0);
+            }
+            children.push_back(pid);
+        }
+
+        auto failed = false;
+        for (auto pid : children) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        if (failed)
+            throw std::runtime_error("shard worker failed, rerun to resume");
+
+        ShardResult merged;
+        for (uint64_t c = 0; c < chunks; ++c)
+            merged.merge(ShardResult::load(chunkPath(directory, c)));
+        if (merged.equity.boards != boards)
+            throw std::runtime_error("shards do not cover the spot");
+        return merged;
+    }
+
+private:
+    void work(const std::vector<std::vector<CardValue_52_t>>& players, const std::string& directory,
+              unsigned worker, uint64_t chunks) {
+        const auto spot = Spot::toString(players);
+        const auto boards = m_predictor.numberOfBoards(players);
+        for (uint64_t c = worker; c < chunks; c += m_workers) {
+            auto path = chunkPath(directory, c);
+            if (::access(path.c_str(), F_OK) == 0) {
+                auto existing = ShardResult::load(path);
+                if (existing.spot != spot || existing.equity.begin != c * m_chunkSize
+                    || existing.equity.boards != std::min(m_chunkSize, boards - c * m_chunkSize))
+                    throw std::runtime_error("shard " + path + " does not belong to chunk " + std::to_string(c) + " of " + spot);
+                continue;
+            }
+
+            ShardResult result;
+            result.spot = spot;
+            result.equity = m_predictor.predictRange(players, c * m_chunkSize, m_chunkSize);
+            result.store(path);
+        }
+    }
+
+    // Writes the manifest of a fresh directory, or checks the one already there.
+    void claim(const std::string& directory, const std::vector<std::vector<CardValue_52_t>>& players) {
+        const auto manifest = "manifest " + Spot::toString(players) + ' ' + std::to_string(m_chunkSize);
+        const auto path = directory + "/manifest";
+        std::ifstream in(path);
+        std::string line;
+        if (std::getline(in, line)) {
+            if (line != manifest)
+                throw std::runtime_error(directory + " holds shards of another run: " + line);
+            return;
+        }
+
+        auto tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            out << manifest << '\n';
+            if (!out)
+                throw std::runtime_error("cannot write shard manifest " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("cannot rename shard manifest " + tmp);
+    }
+
+    static std::string chunkPath(const std::string& directory, uint64_t chunk) {
+        return directory + "/" + std::to_string(chunk) + ".shard";
+    }
+
+    Predictor m_predictor;
+    unsigned m_workers;
+    uint64_t m_chunkSize;
+};
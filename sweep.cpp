@@ -0,0 +1,60 @@
+#include "sweep.h"
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// sweep [--threads n] [--limit hands]
+// Runs every seven card hand through all analyzers, cross-checks them and reports
+// throughput. A full sweep also checks the number of hands of every category.
+// Exits non-zero on any disagreement.
+int main(int argc, char** argv) {
+    unsigned threads = std::thread::hardware_concurrency();
+    uint64_t limit = ExhaustiveSweep::totalHands;
+    for (auto i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        } else if (arg == "--limit" && i + 1 < argc) {
+            limit = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "usage: sweep [--threads n] [--limit hands]\n";
+            return 1;
+        }
+    }
+
+    ExhaustiveSweep sweep{threads};
+    auto report = sweep.run(limit);
+
+    std::cout << report.hands << " hands on " << report.threads << " threads in " << std::fixed << std::setprecision(1)
+              << report.seconds << " s, " << report.mismatches << " mismatches" << std::endl;
+    for (const auto& example : report.examples)
+        std::cout << "  " << example << std::endl;
+
+    for (auto i = 0; i < ExhaustiveSweep::ImplementationCount; ++i) {
+        auto implementation = static_cast<ExhaustiveSweep::Implementation>(i);
+        std::cout << std::left << std::setw(24) << report.names[i] << std::right << std::setw(14)
+                  << static_cast<uint64_t>(report.handsPerSecond(implementation)) << " hands/sec" << std::endl;
+    }
+
+    const char* names[] = {"high card", "pair", "two pair", "set", "straight", "flush", "full house", "quads", "straight flush"};
+    std::cout << std::left << std::setw(16) << "category" << std::right;
+    for (auto name : report.names)
+        std::cout << std::setw(24) << name;
+    std::cout << std::setw(24) << "expected" << std::endl;
+    for (auto r = 0u; r < ExhaustiveSweep::categories; ++r) {
+        std::cout << std::left << std::setw(16) << names[r] << std::right;
+        for (const auto& counts : report.counts)
+            std::cout << std::setw(24) << counts[r];
+        std::cout << std::setw(24) << ExhaustiveSweep::expectedCounts[r] << std::endl;
+    }
+
+    if (report.mismatches > 0)
+        return 1;
+    if (report.complete() && !report.countsMatch()) {
+        std::cerr << "category counts differ from the expected ones" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "analyzer.h"
+#include "card.h"
+#include "fastanalyzer.h"
+#include "predictor.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every seven card hand, in CombinationCalculator order, through Analyzer,
+// FastAnalyzer::analyze and FastAnalyzer::evaluate. Hands are handed out in chunks;
+// each implementation is timed over the whole chunk, then the results are compared:
+// all three must agree on the hand, and on how it orders against the previous hand.
+class ExhaustiveSweep {
+public:
+    static constexpr uint64_t totalHands = 133784560;
+    static constexpr unsigned categories = 9;
+
+    // Seven card hands per Hand::Rank.
+    static constexpr std::array<uint64_t, categories> expectedCounts = {
+        23294460, 58627800, 31433400, 6461620, 6180020, 4047644, 3473184, 224848, 41584};
+
+    enum Implementation {
+        AnalyzerImpl = 0,
+        FastAnalyzerImpl,
+        EvaluateImpl,
+        ImplementationCount
+    };
+
+    struct Report {
+        uint64_t hands = 0;
+        uint64_t mismatches = 0;
+        double seconds = 0.;
+        unsigned threads = 0;
+        std::array<const char*, ImplementationCount> names{"Analyzer::analyze", "FastAnalyzer::analyze", "FastAnalyzer::evaluate"};
+        std::array<double, ImplementationCount> busySeconds{};
+        std::array<std::array<uint64_t, categories>, ImplementationCount> counts{};
+        std::vector<std::string> examples;
+
+        bool complete() const { return hands == totalHands; }
+
+        bool countsMatch() const {
+            for (const auto& implementation : counts)
+                if (implementation != expectedCounts)
+                    return false;
+            return true;
+        }
+
+        // Hands per second of one implementation if all threads ran only it.
+        double handsPerSecond(Implementation implementation) const {
+            return busySeconds[implementation] > 0. ? hands * threads / busySeconds[implementation] : 0.;
+        }
+    };
+
+    static constexpr size_t maxExamples = 16;
+
+    explicit ExhaustiveSweep(unsigned threads = std::thread::hardware_concurrency(), uint64_t chunkSize = 1 << 15)
+        : m_threads{std::max(threads, 1u)}, m_chunkSize{chunkSize} {}
+
+    // Sweeps the first limit hands.
+    Report run(uint64_t limit = totalHands) {
+        using Clock = std::chrono::steady_clock;
+
+        Report report;
+        report.hands = std::min(limit, totalHands);
+        report.threads = m_threads;
+        const auto chunks = (report.hands + m_chunkSize - 1) / m_chunkSize;
+        std::atomic<uint64_t> next{0};
+        std::mutex mutex;
+
+        auto worker = [&]() {
+            Analyzer analyzer{};
+            FastAnalyzer fast{};
+            Report local;
+            std::vector<std::vector<CardValue_52_t>> cards(m_chunkSize, std::vector<CardValue_52_t>(7));
+            std::vector<FastAnalyzer::Deck_t> decks(m_chunkSize);
+            std::vector<std::unique_ptr<Hand>> slow(m_chunkSize);
+            std::vector<std::unique_ptr<Hand>> quick(m_chunkSize);
+            std::vector<FastAnalyzer::Value_t> values(m_chunkSize);
+
+            for (auto c = next++; c < chunks; c = next++) {
+                const auto begin = c * m_chunkSize;
+                const auto count = std::min(m_chunkSize, report.hands - begin);
+
+                auto indices = CombinationCalculator::unrank(begin, 52, 7);
+                for (uint64_t h = 0; h < count; ++h) {
+                    decks[h] = 0;
+                    for (auto i = 0; i < 7; ++i) {
+                        cards[h][i] = indices[i];
+                        decks[h] |= FastAnalyzer::Deck_t{1} << indices[i];
+                    }
+                    CombinationCalculator::next(indices, 52);
+                }
+
+                auto t0 = Clock::now();
+                for (uint64_t h = 0; h < count; ++h)
+                    slow[h] = analyzer.analyze(cards[h]);
+                auto t1 = Clock::now();
+                for (uint64_t h = 0; h < count; ++h)
+                    quick[h] = fast.analyze(decks[h]);
+                auto t2 = Clock::now();
+                for (uint64_t h = 0; h < count; ++h)
+                    values[h] = FastAnalyzer::evaluate(decks[h]);
+                auto t3 = Clock::now();
+
+                local.busySeconds[AnalyzerImpl] += std::chrono::duration<double>(t1 - t0).count();
+                local.busySeconds[FastAnalyzerImpl] += std::chrono::duration<double>(t2 - t1).count();
+                local.busySeconds[EvaluateImpl] += std::chrono::duration<double>(t3 - t2).count();
+
+                for (uint64_t h = 0; h < count; ++h) {
+                    local.counts[AnalyzerImpl][slow[h]->getRank()] += 1;
+                    local.counts[FastAnalyzerImpl][quick[h]->getRank()] += 1;
+                    local.counts[EvaluateImpl][FastAnalyzer::rank(values[h])] += 1;
+                    if (!agree(slow, quick, values, h))
+                        mismatch(local, cards[h], *slow[h], *quick[h], values[h]);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            report.mismatches += local.mismatches;
+            for (auto i = 0; i < ImplementationCount; ++i) {
+                report.busySeconds[i] += local.busySeconds[i];
+                for (auto r = 0u; r < categories; ++r)
+                    report.counts[i][r] += local.counts[i][r];
+            }
+            for (auto& example : local.examples)
+                if (report.examples.size() < maxExamples)
+                    report.examples.push_back(std::move(example));
+        };
+
+        const auto tstart = Clock::now();
+        std::vector<std::thread> pool;
+        for (auto t = 0u; t < m_threads; ++t)
+            pool.emplace_back(worker);
+        for (auto& thread : pool)
+            thread.join();
+        report.seconds = std::chrono::duration<double>(Clock::now() - tstart).count();
+        return report;
+    }
+
+private:
+    // Same hand from all three, and the same order against the previous hand of the chunk.
+    static bool agree(const std::vector<std::unique_ptr<Hand>>& slow, const std::vector<std::unique_ptr<Hand>>& quick,
+                      const std::vector<FastAnalyzer::Value_t>& values, uint64_t h) {
+        auto& a = *slow[h];
+        auto& b = *quick[h];
+        if (a.getRank() != FastAnalyzer::rank(values[h]) || a != b)
+            return false;
+        if (h == 0)
+            return true;
+
+        const auto previous = values[h - 1];
+        const bool below = values[h] < previous;
+        const bool equal = values[h] == previous;
+        return (a < *slow[h - 1]) == below && (a == *slow[h - 1]) == equal
+            && (b < *quick[h - 1]) == below && (b == *quick[h - 1]) == equal;
+    }
+
+    static void mismatch(Report& local, const std::vector<CardValue_52_t>& cards, Hand& slow, Hand& quick,
+                         FastAnalyzer::Value_t value) {
+        local.mismatches += 1;
+        if (local.examples.size() >= maxExamples)
+            return;
+        std::string example;
+        for (auto card : cards)
+            example += Card::toString(card) + ' ';
+        char hex[16];
+        std::snprintf(hex, sizeof(hex), "%06x", value);
+        example += "| " + slow.asString() + " | " + quick.asString() + " | " + hex;
+        local.examples.push_back(example);
+    }
+
+    unsigned m_threads;
+    uint64_t m_chunkSize;
+};